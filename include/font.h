@@ -0,0 +1,84 @@
+#ifndef _include_font_h_
+#define _include_font_h_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+#define FONT_FIRST_GLYPH ' '
+#define FONT_LAST_GLYPH '~'
+#define FONT_GLYPH_COUNT (FONT_LAST_GLYPH - FONT_FIRST_GLYPH + 1)
+
+/*
+ * Printable ASCII baked into signed distance fields, one glyph per square
+ * layer of GlyphSize pixels with the glyph in the top left corner. Edges
+ * sit at 0.5, anything outside the glyph fades to 0.
+ */
+typedef struct FontGlyph
+{
+	float Advance;
+	float OffsetX;
+	float OffsetY;
+	int Empty;
+}
+FontGlyph;
+
+typedef struct Font
+{
+	float PixelHeight;
+	float LineHeight;
+	uint32_t GlyphSize;
+	FontGlyph Glyphs[FONT_GLYPH_COUNT];
+	uint8_t* Pixels;
+}
+Font;
+
+/*
+ * One laid out glyph, a square of Size units centered on X, Y. Glyph is
+ * both the layer in the font texture and the index into Glyphs.
+ */
+typedef struct FontQuad
+{
+	float X;
+	float Y;
+	float Size;
+	uint32_t Glyph;
+}
+FontQuad;
+
+extern int
+FontLoad(
+	Font* Font,
+	const char* Path,
+	float PixelHeight
+	);
+
+extern void
+FontFree(
+	Font* Font
+	);
+
+/*
+ * Lays Text out with its first baseline at Y, in units where a line is
+ * Height tall and Y grows downwards. Returns the number of quads the text
+ * needs, at most Capacity of which are written.
+ */
+extern uint32_t
+FontLayout(
+	const Font* Font,
+	const char* Text,
+	float X,
+	float Y,
+	float Height,
+	FontQuad* Quads,
+	uint32_t Capacity
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _include_font_h_ */
@@ -0,0 +1,235 @@
+#ifndef _include_graph_h_
+#define _include_graph_h_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+#include <vulkan/vulkan.h>
+
+/*
+ * Per-frame render graph. Resources are imported with the way the previous
+ * frame left them, passes declare how they use each one, and execution puts
+ * a single batched barrier in front of every pass that needs one. Buffers
+ * share one global memory barrier, images get their own for layout changes.
+ * An image use with an UNDEFINED layout is left to the pass, which is how a
+ * render pass doing its own transitions declares its attachments.
+ *
+ * Transient images are created by the graph instead of imported. Their
+ * first and last pass come from the uses of the frame they are allocated
+ * for, and images whose passes do not overlap share memory.
+ */
+
+typedef void
+(*GraphRecord)(
+	VkCommandBuffer CommandBuffer,
+	void* Data
+	);
+
+/*
+ * Returns the memory type transient images go into, out of the types in Bits.
+ */
+typedef uint32_t
+(*GraphMemory)(
+	uint32_t Bits
+	);
+
+typedef struct GraphResource
+{
+	VkImage Image;
+	VkImageAspectFlags Aspect;
+	uint32_t Layers;
+	VkImageLayout Layout;
+
+	VkPipelineStageFlags WriteStages;
+	VkAccessFlags WriteAccess;
+	VkPipelineStageFlags ReadStages;
+	VkAccessFlags ReadAccess;
+
+	/* Index into Images, UINT32_MAX for imported resources */
+	uint32_t Transient;
+}
+GraphResource;
+
+typedef struct GraphUse
+{
+	uint32_t Resource;
+	VkPipelineStageFlags Stages;
+	VkAccessFlags Access;
+	VkImageLayout Layout;
+	VkImageLayout FinalLayout;
+}
+GraphUse;
+
+typedef struct GraphPass
+{
+	GraphRecord Record;
+	void* Data;
+	uint32_t FirstUse;
+	uint32_t UseCount;
+}
+GraphPass;
+
+typedef struct GraphImage
+{
+	VkFormat Format;
+	VkImageAspectFlags Aspect;
+	VkImageUsageFlags Usage;
+	VkSampleCountFlagBits Samples;
+	VkExtent2D Extent;
+
+	/* Resource of the frame being built */
+	uint32_t Resource;
+
+	uint32_t FirstPass;
+	uint32_t LastPass;
+	uint32_t Allocation;
+	VkDeviceSize Offset;
+	VkDeviceSize Size;
+
+	VkImage Image;
+	VkImageView View;
+
+	/* Only set on the first image in each allocation, which frees it */
+	VkDeviceMemory Memory;
+}
+GraphImage;
+
+typedef struct RenderGraph
+{
+	GraphResource* Resources;
+	uint32_t ResourceCount;
+	uint32_t ResourceSize;
+
+	GraphPass* Passes;
+	uint32_t PassCount;
+	uint32_t PassSize;
+
+	GraphUse* Uses;
+	uint32_t UseCount;
+	uint32_t UseSize;
+
+	VkImageMemoryBarrier* Barriers;
+	uint32_t BarrierSize;
+
+	/* Kept across resets, declared again in the same order every frame */
+	GraphImage* Images;
+	uint32_t ImageCount;
+	uint32_t ImageSize;
+	uint32_t ImageDeclared;
+}
+RenderGraph;
+
+extern void
+GraphFree(
+	RenderGraph* Graph
+	);
+
+extern void
+GraphReset(
+	RenderGraph* Graph
+	);
+
+extern uint32_t
+GraphImportBuffer(
+	RenderGraph* Graph,
+	VkPipelineStageFlags Stages,
+	VkAccessFlags Access
+	);
+
+extern uint32_t
+GraphImportImage(
+	RenderGraph* Graph,
+	VkImage Image,
+	VkImageAspectFlags Aspect,
+	uint32_t Layers,
+	VkPipelineStageFlags Stages,
+	VkAccessFlags Access,
+	VkImageLayout Layout
+	);
+
+/*
+ * Declares a transient image and returns its resource. The first frame
+ * declaring it adds it to the graph, later frames have to describe it the
+ * same way and get the same image back.
+ */
+extern uint32_t
+GraphCreateImage(
+	RenderGraph* Graph,
+	VkFormat Format,
+	VkImageAspectFlags Aspect,
+	VkImageUsageFlags Usage,
+	VkSampleCountFlagBits Samples,
+	VkExtent2D Extent
+	);
+
+/*
+ * Creates the transient images declared by the frame just built and places
+ * them in memory by the passes that use them. Does nothing while the images
+ * of an earlier call are still held.
+ */
+extern void
+GraphAllocate(
+	RenderGraph* Graph,
+	VkDevice Device,
+	GraphMemory Memory
+	);
+
+extern VkImageView
+GraphGetView(
+	const RenderGraph* Graph,
+	uint32_t Resource
+	);
+
+/*
+ * Forgets the transient images, the caller destroys them once no frame
+ * uses them anymore. The next GraphAllocate creates them again.
+ */
+extern void
+GraphReleaseImages(
+	RenderGraph* Graph
+	);
+
+/*
+ * Passes run in the order they are added. A pass without a Record function
+ * only moves its resources into the state it declares.
+ */
+extern void
+GraphAddPass(
+	RenderGraph* Graph,
+	GraphRecord Record,
+	void* Data
+	);
+
+extern void
+GraphUseBuffer(
+	RenderGraph* Graph,
+	uint32_t Resource,
+	VkPipelineStageFlags Stages,
+	VkAccessFlags Access
+	);
+
+extern void
+GraphUseImage(
+	RenderGraph* Graph,
+	uint32_t Resource,
+	VkPipelineStageFlags Stages,
+	VkAccessFlags Access,
+	VkImageLayout Layout,
+	VkImageLayout FinalLayout
+	);
+
+extern void
+GraphExecute(
+	RenderGraph* Graph,
+	VkCommandBuffer CommandBuffer
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _include_graph_h_ */
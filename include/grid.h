@@ -0,0 +1,157 @@
+#ifndef _include_grid_h_
+#define _include_grid_h_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*
+ * Loose hashed grid. Every item lives in exactly one cell, the one holding
+ * its center, and queries widen their rectangle by the largest half extent
+ * ever inserted. Cells keep their entries packed so a query only walks
+ * contiguous memory.
+ */
+
+typedef struct GridEntry
+{
+	uint32_t ID;
+	float X;
+	float Y;
+	float HalfWidth;
+	float HalfHeight;
+}
+GridEntry;
+
+typedef struct GridCell
+{
+	int32_t X;
+	int32_t Y;
+	GridEntry* Entries;
+	uint32_t Count;
+	uint32_t Size;
+}
+GridCell;
+
+typedef struct GridItem
+{
+	uint32_t Cell;
+	uint32_t Slot;
+}
+GridItem;
+
+typedef struct Grid
+{
+	float Spacing;
+	float MaxHalfWidth;
+	float MaxHalfHeight;
+
+	GridCell* Cells;
+	uint32_t CellCount;
+	uint32_t CellSize;
+
+	uint32_t* Table;
+	uint32_t TableSize;
+
+	GridItem* Items;
+	uint32_t ItemSize;
+}
+Grid;
+
+typedef struct GridCells
+{
+	const Grid* Grid;
+	int32_t MinX;
+	int32_t MinY;
+	int32_t MaxX;
+	int32_t MaxY;
+	int32_t X;
+	int32_t Y;
+	uint32_t Cell;
+	int Scan;
+}
+GridCells;
+
+extern void
+GridInit(
+	Grid* Grid,
+	float CellSize
+	);
+
+extern void
+GridFree(
+	Grid* Grid
+	);
+
+extern void
+GridInsert(
+	Grid* Grid,
+	uint32_t ID,
+	float X,
+	float Y,
+	float HalfWidth,
+	float HalfHeight
+	);
+
+/*
+ * Moving or removing an ID that is not in the grid does nothing.
+ */
+extern void
+GridMove(
+	Grid* Grid,
+	uint32_t ID,
+	float X,
+	float Y
+	);
+
+extern void
+GridRemove(
+	Grid* Grid,
+	uint32_t ID
+	);
+
+/*
+ * Whether the rectangle of Entry touches the given one, edges included.
+ */
+extern int
+GridOverlaps(
+	const GridEntry* Entry,
+	float MinX,
+	float MinY,
+	float MaxX,
+	float MaxY
+	);
+
+extern uint32_t
+GridQuery(
+	const Grid* Grid,
+	float MinX,
+	float MinY,
+	float MaxX,
+	float MaxY,
+	uint32_t* IDs,
+	uint32_t Capacity
+	);
+
+extern void
+GridBeginCells(
+	const Grid* Grid,
+	float MinX,
+	float MinY,
+	float MaxX,
+	float MaxY,
+	GridCells* Cells
+	);
+
+extern const GridCell*
+GridNextCell(
+	GridCells* Cells
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _include_grid_h_ */
@@ -0,0 +1,141 @@
+#ifndef _include_record_h_
+#define _include_record_h_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Binary log of everything a frame takes from outside the renderer. The file
+ * starts with a RecordHeader and holds one RecordFrame per frame, followed by
+ * SpriteCount RecordSprite entries. Sprites are only written when they
+ * changed since the last time they were written. Everything is stored in
+ * host byte order, so logs move between machines of the same endianness.
+ */
+
+#define RECORD_MAGIC 0x72706432 /* "2dpr" */
+#define RECORD_VERSION 1
+#define RECORD_MAX_SPRITES (1 << 20)
+
+typedef struct RecordHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Quality;
+	uint32_t Scaling;
+}
+RecordHeader;
+
+typedef struct RecordFrame
+{
+	float Delta;
+	float FrameTime;
+	float Rotation;
+	float View[4];
+	uint32_t Seed;
+	uint8_t QualitySteps;
+	uint8_t ScalingToggles;
+	uint8_t HeatMapToggles;
+	uint8_t Scale;
+	uint32_t SpriteCount;
+}
+RecordFrame;
+
+typedef struct RecordSprite
+{
+	uint32_t ID;
+	float X;
+	float Y;
+	float Rotation;
+}
+RecordSprite;
+
+typedef struct RecordLog
+{
+	FILE* File;
+	RecordHeader Header;
+	uint64_t Frames;
+
+	/* The frame being written or the one read last */
+	RecordFrame Frame;
+	RecordSprite* Sprites;
+	uint32_t SpriteSize;
+
+	/* Last written state of every sprite, an ID of UINT32_MAX is unwritten */
+	RecordSprite* Written;
+	uint32_t WrittenSize;
+
+	/*
+	 * Where each sprite sits in Sprites, only valid when that entry of the
+	 * frame being written has its ID. Sized like Written.
+	 */
+	uint32_t* Slots;
+}
+RecordLog;
+
+/*
+ * Creates Path and writes Header to it. Returns -1 when the file could not
+ * be written.
+ */
+extern int
+RecordCreate(
+	RecordLog* Log,
+	const char* Path,
+	const RecordHeader* Header
+	);
+
+/*
+ * Opens Path for reading and loads its header into Log->Header. Returns -1
+ * when the file is missing or is not a log of this version.
+ */
+extern int
+RecordOpen(
+	RecordLog* Log,
+	const char* Path
+	);
+
+extern void
+RecordClose(
+	RecordLog* Log
+	);
+
+/*
+ * Adds a sprite change to the frame being written, dropped when the sprite
+ * was last written with the same values.
+ */
+extern void
+RecordSetSprite(
+	RecordLog* Log,
+	uint32_t ID,
+	float X,
+	float Y,
+	float Rotation
+	);
+
+/*
+ * Appends Log->Frame with its sprite changes and starts the next frame
+ * without any. Returns -1 on a failed write.
+ */
+extern int
+RecordWrite(
+	RecordLog* Log
+	);
+
+/*
+ * Reads the next frame into Log->Frame and its sprite changes into
+ * Log->Sprites. Returns 0 at the end of the log.
+ */
+extern int
+RecordRead(
+	RecordLog* Log
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _include_record_h_ */
@@ -0,0 +1,29 @@
+#ifndef _include_sort_h_
+#define _include_sort_h_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*
+ * Stable LSD radix sort of 64 bit keys, carrying a 32 bit value along with
+ * every key. The temporary arrays must hold Count elements each. The sorted
+ * result always ends up in Keys and Values.
+ */
+extern void
+RadixSort(
+	uint64_t* Keys,
+	uint32_t* Values,
+	uint64_t* TempKeys,
+	uint32_t* TempValues,
+	uint32_t Count
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _include_sort_h_ */
@@ -0,0 +1,88 @@
+#ifndef _include_transform_h_
+#define _include_transform_h_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+#define TRANSFORM_ROOT UINT32_MAX
+
+/*
+ * Flat 2D transform hierarchy stored as structure of arrays. A parent is
+ * always added before its children, so walking the arrays in order visits
+ * every parent before anything attached to it and a single pass is enough
+ * to propagate dirty flags and compose world transforms.
+ */
+typedef struct Transforms
+{
+	uint32_t Count;
+	uint32_t Size;
+
+	uint32_t* Parent;
+	uint8_t* Dirty;
+
+	float* X;
+	float* Y;
+	float* Rotation;
+
+	float* WorldX;
+	float* WorldY;
+	float* WorldRotation;
+	float* WorldCos;
+	float* WorldSin;
+
+	uint32_t* Updated;
+
+	/* Dense copies of the batch for the trigonometry pass */
+	float* BatchRotation;
+	float* BatchCos;
+	float* BatchSin;
+}
+Transforms;
+
+extern void
+TransformsInit(
+	Transforms* Transforms
+	);
+
+extern void
+TransformsFree(
+	Transforms* Transforms
+	);
+
+extern uint32_t
+TransformAdd(
+	Transforms* Transforms,
+	uint32_t Parent,
+	float X,
+	float Y,
+	float Rotation
+	);
+
+extern void
+TransformSet(
+	Transforms* Transforms,
+	uint32_t Index,
+	float X,
+	float Y,
+	float Rotation
+	);
+
+/*
+ * Recomputes the world transform of every dirty entry and everything below
+ * it. Returns how many were recomputed, their indices are left in Updated
+ * in ascending order.
+ */
+extern uint32_t
+TransformsUpdate(
+	Transforms* Transforms
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _include_transform_h_ */
@@ -6,6 +6,7 @@ extern "C"
 {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define ARRAYLEN(A) (sizeof(A)/sizeof(A[0]))
@@ -31,6 +32,10 @@ WriteFile(
 	uint8_t* Buffer
 	);
 
+/*
+ * Returns -1 for a missing, empty or short file, Buffer is only allocated
+ * on success.
+ */
 extern int
 ReadFile(
 	const char* Path,
@@ -38,6 +43,18 @@ ReadFile(
 	uint8_t** Buffer
 	);
 
+/*
+ * Makes room for element Count in Array, which has room for *Size elements
+ * of Element bytes. The size doubles, starting at 8, until Count fits.
+ */
+extern void*
+GrowArray(
+	void* Array,
+	uint32_t* Size,
+	uint32_t Count,
+	size_t Element
+	);
+
 #ifdef __cplusplus
 }
 #endif
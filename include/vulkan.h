@@ -11,7 +11,11 @@ VulkanInit(
 	void
 	);
 
-extern void
+/*
+ * Returns the exit status, which is only non-zero when a regression run
+ * started by VULKAN_GOLDEN or VULKAN_BASELINE failed.
+ */
+extern int
 VulkanRun(
 	void
 	);
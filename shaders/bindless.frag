@@ -0,0 +1,37 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(binding = 0) uniform sampler2DArray inTex[];
+layout(binding = 1) uniform usampler2DArray inIndexedTex;
+layout(binding = 2) uniform sampler2DArray inPaletteTex;
+layout(binding = 3) uniform sampler2DArray inFontTex;
+
+layout(location = 0) in vec2 inTexCoord;
+layout(location = 1) flat in uint inTexIdx;
+layout(location = 2) flat in uint inPaletteIdx;
+layout(location = 3) flat in uint inTexture;
+layout(location = 4) in vec4 inColor;
+layout(location = 5) flat in uint inFlags;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    if((inFlags & 1u) != 0) {
+        float dist = texture(inFontTex, vec3(inTexCoord, inTexIdx)).r;
+        float edge = fwidth(dist);
+        float alpha = smoothstep(0.5 - edge, 0.5 + edge, dist);
+        if(alpha <= 0.0) {
+            discard;
+        }
+        outColor = vec4(1.0, 1.0, 1.0, alpha);
+    } else if(inTexture != 0 && inPaletteIdx == 0) {
+        outColor = texture(inTex[nonuniformEXT(inTexture)], vec3(inTexCoord, inTexIdx));
+    } else {
+        // Sheet 0 only exists indexed, palette 0 draws it with its own colors
+        ivec2 size = textureSize(inIndexedTex, 0).xy;
+        ivec2 texel = clamp(ivec2(inTexCoord * vec2(size)), ivec2(0), size - 1);
+        uint index = texelFetch(inIndexedTex, ivec3(texel, inTexIdx), 0).r;
+        outColor = texelFetch(inPaletteTex, ivec3(index, 0, max(inPaletteIdx, 1u) - 1u), 0);
+    }
+    outColor *= inColor;
+}
@@ -0,0 +1,8 @@
+#version 450
+
+layout(location = 0) out vec4 outCount;
+
+/* Blended with ONE, ONE so every shaded fragment adds one */
+void main() {
+    outCount = vec4(1.0);
+}
@@ -0,0 +1,15 @@
+#version 450
+
+layout(binding = 0) uniform sampler2DArray inHeat;
+
+layout(location = 0) out vec4 outColor;
+
+/* Black where nothing was drawn, then blue through red up to 16 layers */
+void main() {
+    float count = texelFetch(inHeat, ivec3(gl_FragCoord.xy, 0), 0).r;
+    float t = clamp(log2(max(count, 1.0)) / 4.0, 0.0, 1.0);
+
+    vec3 ramp = clamp(1.5 - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);
+
+    outColor = vec4(count > 0.5 ? ramp : vec3(0.0), 1.0);
+}
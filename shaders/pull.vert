@@ -0,0 +1,58 @@
+#version 450
+
+layout(set = 0, binding = 4) uniform Constants {
+    mat4 transform;
+} consts;
+
+/* Matches VkVertexInstanceInput field for field */
+struct Instance {
+    float x;
+    float y;
+    float z;
+    float width;
+    float height;
+    float rotation;
+    uint texIndex;
+    uint palette;
+    uint texture;
+    uint color;
+    uint flags;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout(location = 0) out vec2 outTexCoord;
+layout(location = 1) flat out uint outTexIdx;
+layout(location = 2) flat out uint outPaletteIdx;
+layout(location = 3) flat out uint outTexture;
+layout(location = 4) out vec4 outColor;
+layout(location = 5) flat out uint outFlags;
+
+void main() {
+    Instance instance = instances[gl_InstanceIndex];
+
+    /* Triangle strip over the corners of a unit quad */
+    vec2 texCoord = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+	vec2 corner = (texCoord - 0.5) * vec2(instance.width, instance.height);
+	float c = cos(instance.rotation);
+	float s = sin(instance.rotation);
+
+    gl_Position = consts.transform *
+		vec4(
+			vec2(
+				c * corner.x - s * corner.y + instance.x,
+				s * corner.x + c * corner.y + instance.y
+			),
+			instance.z,
+			1.0
+		);
+
+    outTexCoord = texCoord;
+	outTexIdx = instance.texIndex;
+	outPaletteIdx = instance.palette;
+	outTexture = instance.texture;
+	outColor = unpackUnorm4x8(instance.color);
+	outFlags = instance.flags;
+}
@@ -1,6 +1,6 @@
 #version 450
 
-layout(push_constant) uniform Constants {
+layout(set = 0, binding = 4) uniform Constants {
     mat4 transform;
 } consts;
 
@@ -11,16 +11,28 @@ layout(location = 2) in vec3 inPosition;
 layout(location = 3) in vec2 inDimensions;
 layout(location = 4) in float inRotation;
 layout(location = 5) in uint inTexIndex;
+layout(location = 6) in uint inPalette;
+layout(location = 7) in uint inTexture;
+layout(location = 8) in vec4 inColor;
+layout(location = 9) in uint inFlags;
 
 layout(location = 0) out vec2 outTexCoord;
 layout(location = 1) flat out uint outTexIdx;
+layout(location = 2) flat out uint outPaletteIdx;
+layout(location = 3) flat out uint outTexture;
+layout(location = 4) out vec4 outColor;
+layout(location = 5) flat out uint outFlags;
 
 void main() {
+	vec2 corner = inVertexPosition * inDimensions;
+	float c = cos(inRotation);
+	float s = sin(inRotation);
+
     gl_Position = consts.transform *
 		vec4(
 			vec2(
-				inVertexPosition.x * inDimensions.x + inPosition.x,
-				inVertexPosition.y * inDimensions.y + inPosition.y
+				c * corner.x - s * corner.y + inPosition.x,
+				s * corner.x + c * corner.y + inPosition.y
 			),
 			inPosition.z,
 			1.0
@@ -28,4 +40,8 @@ void main() {
 
     outTexCoord = inTexCoords;
 	outTexIdx = inTexIndex;
+	outPaletteIdx = inPalette;
+	outTexture = inTexture;
+	outColor = inColor;
+	outFlags = inFlags;
 }
@@ -0,0 +1,171 @@
+#include "../include/font.h"
+#include "../include/debug.h"
+#include "../include/util.h"
+
+#include <math.h>
+#include <string.h>
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <stb/stb_truetype.h>
+
+
+/* Distance in pixels the field keeps on either side of an edge */
+static const int FontPadding = 6;
+
+
+int
+FontLoad(
+	Font* Font,
+	const char* Path,
+	float PixelHeight
+	)
+{
+	memset(Font, 0, sizeof(*Font));
+
+	uint64_t Length;
+	uint8_t* Data;
+
+	if(ReadFile(Path, &Length, &Data) != 0)
+	{
+		return -1;
+	}
+
+	stbtt_fontinfo Info;
+
+	if(!stbtt_InitFont(&Info, Data, stbtt_GetFontOffsetForIndex(Data, 0)))
+	{
+		free(Data);
+		return -1;
+	}
+
+	float Scale = stbtt_ScaleForPixelHeight(&Info, PixelHeight);
+
+	int Ascent;
+	int Descent;
+	int LineGap;
+	stbtt_GetFontVMetrics(&Info, &Ascent, &Descent, &LineGap);
+
+	Font->PixelHeight = PixelHeight;
+	Font->LineHeight = (Ascent - Descent + LineGap) * Scale;
+	Font->GlyphSize = (uint32_t) ceilf(PixelHeight) + FontPadding * 2;
+
+	uint32_t LayerSize = Font->GlyphSize * Font->GlyphSize;
+
+	Font->Pixels = calloc(FONT_GLYPH_COUNT, LayerSize);
+	AssertNEQ(Font->Pixels, NULL);
+
+	/* Spread the 0 to 255 range over the padding on either side of 128 */
+	float DistanceScale = 128.0f / FontPadding;
+
+	for(uint32_t i = 0; i < FONT_GLYPH_COUNT; ++i)
+	{
+		FontGlyph* Glyph = Font->Glyphs + i;
+		int Codepoint = FONT_FIRST_GLYPH + i;
+
+		int Advance;
+		int Bearing;
+		stbtt_GetCodepointHMetrics(&Info, Codepoint, &Advance, &Bearing);
+
+		Glyph->Advance = Advance * Scale;
+
+		int Width;
+		int Height;
+		int OffsetX;
+		int OffsetY;
+
+		uint8_t* SDF = stbtt_GetCodepointSDF(&Info, Scale, Codepoint, FontPadding, 128,
+			DistanceScale, &Width, &Height, &OffsetX, &OffsetY);
+
+		if(SDF == NULL)
+		{
+			Glyph->Empty = 1;
+			continue;
+		}
+
+		Glyph->OffsetX = OffsetX;
+		Glyph->OffsetY = OffsetY;
+
+		uint8_t* Layer = Font->Pixels + (uint64_t) LayerSize * i;
+		uint32_t Rows = MIN((uint32_t) Height, Font->GlyphSize);
+		uint32_t Columns = MIN((uint32_t) Width, Font->GlyphSize);
+
+		for(uint32_t Row = 0; Row < Rows; ++Row)
+		{
+			memcpy(Layer + Row * Font->GlyphSize, SDF + Row * Width, Columns);
+		}
+
+		stbtt_FreeSDF(SDF, NULL);
+	}
+
+	free(Data);
+
+	return 0;
+}
+
+
+void
+FontFree(
+	Font* Font
+	)
+{
+	free(Font->Pixels);
+	Font->Pixels = NULL;
+}
+
+
+uint32_t
+FontLayout(
+	const Font* Font,
+	const char* Text,
+	float X,
+	float Y,
+	float Height,
+	FontQuad* Quads,
+	uint32_t Capacity
+	)
+{
+	float Scale = Height / Font->LineHeight;
+	float Size = Font->GlyphSize * Scale;
+
+	float PenX = X;
+	float PenY = Y;
+
+	uint32_t Count = 0;
+
+	for(; *Text; ++Text)
+	{
+		if(*Text == '\n')
+		{
+			PenX = X;
+			PenY += Height;
+
+			continue;
+		}
+
+		if(*Text < FONT_FIRST_GLYPH || *Text > FONT_LAST_GLYPH)
+		{
+			continue;
+		}
+
+		uint32_t Index = *Text - FONT_FIRST_GLYPH;
+		const FontGlyph* Glyph = Font->Glyphs + Index;
+
+		if(!Glyph->Empty)
+		{
+			if(Count < Capacity)
+			{
+				FontQuad* Quad = Quads + Count;
+				Quad->X = PenX + Glyph->OffsetX * Scale + Size * 0.5f;
+				Quad->Y = PenY + Glyph->OffsetY * Scale + Size * 0.5f;
+				Quad->Size = Size;
+				Quad->Glyph = Index;
+			}
+
+			++Count;
+		}
+
+		PenX += Glyph->Advance * Scale;
+	}
+
+	return Count;
+}
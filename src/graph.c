@@ -0,0 +1,565 @@
+#include "../include/graph.h"
+#include "../include/debug.h"
+#include "../include/util.h"
+
+#include <stdlib.h>
+
+
+static const VkAccessFlags GraphWriteAccess =
+	VK_ACCESS_SHADER_WRITE_BIT |
+	VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_TRANSFER_WRITE_BIT |
+	VK_ACCESS_HOST_WRITE_BIT |
+	VK_ACCESS_MEMORY_WRITE_BIT;
+
+
+void
+GraphFree(
+	RenderGraph* Graph
+	)
+{
+	free(Graph->Resources);
+	free(Graph->Passes);
+	free(Graph->Uses);
+	free(Graph->Barriers);
+	free(Graph->Images);
+
+	*Graph = (RenderGraph){0};
+}
+
+
+void
+GraphReset(
+	RenderGraph* Graph
+	)
+{
+	Graph->ResourceCount = 0;
+	Graph->PassCount = 0;
+	Graph->UseCount = 0;
+	Graph->ImageDeclared = 0;
+}
+
+
+uint32_t
+GraphImportImage(
+	RenderGraph* Graph,
+	VkImage Image,
+	VkImageAspectFlags Aspect,
+	uint32_t Layers,
+	VkPipelineStageFlags Stages,
+	VkAccessFlags Access,
+	VkImageLayout Layout
+	)
+{
+	Graph->Resources = GrowArray(Graph->Resources, &Graph->ResourceSize,
+		Graph->ResourceCount, sizeof(*Graph->Resources));
+
+	GraphResource* Resource = Graph->Resources + Graph->ResourceCount;
+	Resource->Image = Image;
+	Resource->Aspect = Aspect;
+	Resource->Layers = Layers;
+	Resource->Layout = Layout;
+	Resource->Transient = UINT32_MAX;
+
+	/* An imported read means every earlier write is already visible */
+	if(Access & GraphWriteAccess)
+	{
+		Resource->WriteStages = Stages;
+		Resource->WriteAccess = Access & GraphWriteAccess;
+		Resource->ReadStages = 0;
+		Resource->ReadAccess = 0;
+	}
+	else
+	{
+		Resource->WriteStages = 0;
+		Resource->WriteAccess = 0;
+		Resource->ReadStages = Stages;
+		Resource->ReadAccess = Access;
+	}
+
+	return Graph->ResourceCount++;
+}
+
+
+uint32_t
+GraphImportBuffer(
+	RenderGraph* Graph,
+	VkPipelineStageFlags Stages,
+	VkAccessFlags Access
+	)
+{
+	return GraphImportImage(Graph, VK_NULL_HANDLE, 0, 0, Stages, Access, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+
+uint32_t
+GraphCreateImage(
+	RenderGraph* Graph,
+	VkFormat Format,
+	VkImageAspectFlags Aspect,
+	VkImageUsageFlags Usage,
+	VkSampleCountFlagBits Samples,
+	VkExtent2D Extent
+	)
+{
+	uint32_t Index = Graph->ImageDeclared++;
+
+	if(Index == Graph->ImageCount)
+	{
+		Graph->Images = GrowArray(Graph->Images, &Graph->ImageSize, Graph->ImageCount, sizeof(*Graph->Images));
+
+		GraphImage* Image = Graph->Images + Graph->ImageCount++;
+		*Image = (GraphImage){0};
+		Image->Format = Format;
+		Image->Aspect = Aspect;
+		Image->Usage = Usage;
+		Image->Samples = Samples;
+		Image->Extent = Extent;
+		Image->Image = VK_NULL_HANDLE;
+		Image->View = VK_NULL_HANDLE;
+		Image->Memory = VK_NULL_HANDLE;
+	}
+
+	GraphImage* Image = Graph->Images + Index;
+
+	AssertEQ(Image->Format, Format);
+	AssertEQ(Image->Usage, Usage);
+	AssertEQ(Image->Samples, Samples);
+	AssertEQ(Image->Extent.width, Extent.width);
+	AssertEQ(Image->Extent.height, Extent.height);
+
+	/* Nothing in an earlier pass left anything behind in it */
+	Image->Resource = GraphImportImage(Graph, Image->Image, Aspect, 1, 0, 0, VK_IMAGE_LAYOUT_UNDEFINED);
+	Graph->Resources[Image->Resource].Transient = Index;
+
+	return Image->Resource;
+}
+
+
+/*
+ * First and last pass of the frame being built that use Resource, an unused
+ * resource spans the whole frame.
+ */
+static void
+GraphGetSpan(
+	const RenderGraph* Graph,
+	uint32_t Resource,
+	uint32_t* FirstPass,
+	uint32_t* LastPass
+	)
+{
+	*FirstPass = UINT32_MAX;
+	*LastPass = 0;
+
+	for(uint32_t i = 0; i < Graph->PassCount; ++i)
+	{
+		const GraphPass* Pass = Graph->Passes + i;
+
+		for(uint32_t j = 0; j < Pass->UseCount; ++j)
+		{
+			if(Graph->Uses[Pass->FirstUse + j].Resource == Resource)
+			{
+				*FirstPass = MIN(*FirstPass, i);
+				*LastPass = i;
+			}
+		}
+	}
+
+	if(*FirstPass == UINT32_MAX)
+	{
+		*FirstPass = 0;
+		*LastPass = Graph->PassCount;
+	}
+}
+
+
+static int
+GraphOverlaps(
+	const GraphImage* A,
+	const GraphImage* B
+	)
+{
+	return
+		A->Allocation == B->Allocation &&
+		A->Offset < B->Offset + B->Size &&
+		B->Offset < A->Offset + A->Size;
+}
+
+
+/*
+ * Every image goes after the ones before it whose passes overlap its own,
+ * so each lands at the lowest offset free for its whole lifetime. When the
+ * images share no memory type each gets its own allocation instead.
+ */
+void
+GraphAllocate(
+	RenderGraph* Graph,
+	VkDevice Device,
+	GraphMemory Memory
+	)
+{
+	if(Graph->ImageCount == 0 || Graph->Images[0].Image != VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	VkMemoryRequirements Requirements[Graph->ImageCount];
+	uint32_t Bits = UINT32_MAX;
+	VkDeviceSize Size = 0;
+
+	for(uint32_t i = 0; i < Graph->ImageCount; ++i)
+	{
+		GraphImage* Image = Graph->Images + i;
+
+		VkImageCreateInfo ImageInfo = {0};
+		ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		ImageInfo.pNext = NULL;
+		ImageInfo.flags = 0;
+		ImageInfo.imageType = VK_IMAGE_TYPE_2D;
+		ImageInfo.format = Image->Format;
+		ImageInfo.extent.width = Image->Extent.width;
+		ImageInfo.extent.height = Image->Extent.height;
+		ImageInfo.extent.depth = 1;
+		ImageInfo.mipLevels = 1;
+		ImageInfo.arrayLayers = 1;
+		ImageInfo.samples = Image->Samples;
+		ImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		ImageInfo.usage = Image->Usage;
+		ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		ImageInfo.queueFamilyIndexCount = 0;
+		ImageInfo.pQueueFamilyIndices = NULL;
+		ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkResult Result = vkCreateImage(Device, &ImageInfo, NULL, &Image->Image);
+		AssertEQ(Result, VK_SUCCESS);
+
+		vkGetImageMemoryRequirements(Device, Image->Image, Requirements + i);
+
+		GraphGetSpan(Graph, Image->Resource, &Image->FirstPass, &Image->LastPass);
+
+		VkDeviceSize Offset = 0;
+
+		for(uint32_t j = 0; j < i; ++j)
+		{
+			const GraphImage* Other = Graph->Images + j;
+
+			if(Other->LastPass >= Image->FirstPass && Other->FirstPass <= Image->LastPass)
+			{
+				Offset = MAX(Offset, Other->Offset + Other->Size);
+			}
+		}
+
+		VkDeviceSize Alignment = Requirements[i].alignment;
+
+		Image->Allocation = 0;
+		Image->Offset = (Offset + Alignment - 1) / Alignment * Alignment;
+		Image->Size = Requirements[i].size;
+
+		Bits &= Requirements[i].memoryTypeBits;
+		Size = MAX(Size, Image->Offset + Image->Size);
+	}
+
+	for(uint32_t i = 0; i < Graph->ImageCount; ++i)
+	{
+		GraphImage* Image = Graph->Images + i;
+
+		if(Bits == 0)
+		{
+			Image->Allocation = i;
+			Image->Offset = 0;
+		}
+
+		if(Bits == 0 || i == 0)
+		{
+			VkMemoryAllocateInfo AllocInfo = {0};
+			AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			AllocInfo.pNext = NULL;
+			AllocInfo.allocationSize = Bits ? Size : Image->Size;
+			AllocInfo.memoryTypeIndex = Memory(Bits ? Bits : Requirements[i].memoryTypeBits);
+			AssertNEQ(AllocInfo.memoryTypeIndex, UINT32_MAX);
+
+			VkResult Result = vkAllocateMemory(Device, &AllocInfo, NULL, &Image->Memory);
+			AssertEQ(Result, VK_SUCCESS);
+		}
+
+		VkDeviceMemory Owner = Graph->Images[Image->Allocation].Memory;
+
+		VkResult Result = vkBindImageMemory(Device, Image->Image, Owner, Image->Offset);
+		AssertEQ(Result, VK_SUCCESS);
+
+		VkImageViewCreateInfo ViewInfo = {0};
+		ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		ViewInfo.pNext = NULL;
+		ViewInfo.flags = 0;
+		ViewInfo.image = Image->Image;
+		ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		ViewInfo.format = Image->Format;
+		ViewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		ViewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		ViewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		ViewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		ViewInfo.subresourceRange.aspectMask = Image->Aspect;
+		ViewInfo.subresourceRange.baseMipLevel = 0;
+		ViewInfo.subresourceRange.levelCount = 1;
+		ViewInfo.subresourceRange.baseArrayLayer = 0;
+		ViewInfo.subresourceRange.layerCount = 1;
+
+		Result = vkCreateImageView(Device, &ViewInfo, NULL, &Image->View);
+		AssertEQ(Result, VK_SUCCESS);
+
+		Graph->Resources[Image->Resource].Image = Image->Image;
+	}
+}
+
+
+VkImageView
+GraphGetView(
+	const RenderGraph* Graph,
+	uint32_t Resource
+	)
+{
+	AssertEQ(Resource < Graph->ResourceCount, 1);
+	AssertNEQ(Graph->Resources[Resource].Transient, UINT32_MAX);
+
+	return Graph->Images[Graph->Resources[Resource].Transient].View;
+}
+
+
+void
+GraphReleaseImages(
+	RenderGraph* Graph
+	)
+{
+	Graph->ImageCount = 0;
+	Graph->ImageDeclared = 0;
+}
+
+
+void
+GraphAddPass(
+	RenderGraph* Graph,
+	GraphRecord Record,
+	void* Data
+	)
+{
+	Graph->Passes = GrowArray(Graph->Passes, &Graph->PassSize, Graph->PassCount, sizeof(*Graph->Passes));
+
+	GraphPass* Pass = Graph->Passes + Graph->PassCount++;
+	Pass->Record = Record;
+	Pass->Data = Data;
+	Pass->FirstUse = Graph->UseCount;
+	Pass->UseCount = 0;
+}
+
+
+void
+GraphUseImage(
+	RenderGraph* Graph,
+	uint32_t Resource,
+	VkPipelineStageFlags Stages,
+	VkAccessFlags Access,
+	VkImageLayout Layout,
+	VkImageLayout FinalLayout
+	)
+{
+	AssertNEQ(Graph->PassCount, 0);
+	AssertEQ(Resource < Graph->ResourceCount, 1);
+
+	Graph->Uses = GrowArray(Graph->Uses, &Graph->UseSize, Graph->UseCount, sizeof(*Graph->Uses));
+
+	GraphUse* Use = Graph->Uses + Graph->UseCount++;
+	Use->Resource = Resource;
+	Use->Stages = Stages;
+	Use->Access = Access;
+	Use->Layout = Layout;
+	Use->FinalLayout = FinalLayout;
+
+	++Graph->Passes[Graph->PassCount - 1].UseCount;
+}
+
+
+void
+GraphUseBuffer(
+	RenderGraph* Graph,
+	uint32_t Resource,
+	VkPipelineStageFlags Stages,
+	VkAccessFlags Access
+	)
+{
+	GraphUseImage(Graph, Resource, Stages, Access, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+
+/*
+ * Collects everything the pass waits for into one vkCmdPipelineBarrier.
+ * Reads only wait when the stage or access has not seen the last write
+ * yet, so passes that keep reading the same data add no barrier at all.
+ */
+static void
+GraphRecordBarriers(
+	RenderGraph* Graph,
+	uint32_t PassIndex,
+	VkCommandBuffer CommandBuffer
+	)
+{
+	VkPipelineStageFlags SourceStages = 0;
+	VkPipelineStageFlags DestinationStages = 0;
+	int Hazard = 0;
+
+	VkMemoryBarrier Memory = {0};
+	Memory.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	Memory.pNext = NULL;
+	Memory.srcAccessMask = 0;
+	Memory.dstAccessMask = 0;
+
+	uint32_t ImageCount = 0;
+
+	const GraphPass* Pass = Graph->Passes + PassIndex;
+	const GraphUse* Use = Graph->Uses + Pass->FirstUse;
+	const GraphUse* UseEnd = Use + Pass->UseCount;
+
+	for(; Use != UseEnd; ++Use)
+	{
+		GraphResource* Resource = Graph->Resources + Use->Resource;
+
+		VkPipelineStageFlags Previous = Resource->WriteStages | Resource->ReadStages;
+
+		/* Memory shared with an image that is done has to be finished with first */
+		const GraphImage* Image = Resource->Transient != UINT32_MAX ? Graph->Images + Resource->Transient : NULL;
+
+		for(uint32_t i = 0; Image != NULL && PassIndex == Image->FirstPass && i < Graph->ImageCount; ++i)
+		{
+			const GraphImage* Other = Graph->Images + i;
+			const GraphResource* Done = Graph->Resources + Other->Resource;
+
+			if(Other != Image && Other->LastPass < PassIndex && GraphOverlaps(Image, Other) &&
+				(Done->WriteStages | Done->ReadStages) != 0)
+			{
+				SourceStages |= Done->WriteStages | Done->ReadStages;
+				DestinationStages |= Use->Stages;
+				Memory.srcAccessMask |= Done->WriteAccess;
+				Memory.dstAccessMask |= Use->Access;
+				Hazard = 1;
+			}
+		}
+
+		if(Resource->Image != VK_NULL_HANDLE && Use->Layout != VK_IMAGE_LAYOUT_UNDEFINED &&
+			Use->Layout != Resource->Layout)
+		{
+			Graph->Barriers = GrowArray(Graph->Barriers, &Graph->BarrierSize, ImageCount, sizeof(*Graph->Barriers));
+
+			VkImageMemoryBarrier* Barrier = Graph->Barriers + ImageCount++;
+			*Barrier = (VkImageMemoryBarrier){0};
+			Barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			Barrier->pNext = NULL;
+			Barrier->srcAccessMask = Resource->WriteAccess;
+			Barrier->dstAccessMask = Use->Access;
+			Barrier->oldLayout = Resource->Layout;
+			Barrier->newLayout = Use->Layout;
+			Barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			Barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			Barrier->image = Resource->Image;
+			Barrier->subresourceRange.aspectMask = Resource->Aspect;
+			Barrier->subresourceRange.baseMipLevel = 0;
+			Barrier->subresourceRange.levelCount = 1;
+			Barrier->subresourceRange.baseArrayLayer = 0;
+			Barrier->subresourceRange.layerCount = Resource->Layers;
+
+			SourceStages |= Previous;
+			DestinationStages |= Use->Stages;
+
+			/* The transition is a write the use has already waited for */
+			Resource->WriteStages = Use->Stages;
+			Resource->WriteAccess = Use->Access & GraphWriteAccess;
+			Resource->ReadStages = Use->Access & GraphWriteAccess ? 0 : Use->Stages;
+			Resource->ReadAccess = Use->Access & GraphWriteAccess ? 0 : Use->Access;
+		}
+		else if(Use->Access & GraphWriteAccess)
+		{
+			if(Previous != 0)
+			{
+				SourceStages |= Previous;
+				DestinationStages |= Use->Stages;
+				Memory.srcAccessMask |= Resource->WriteAccess;
+				Memory.dstAccessMask |= Use->Access;
+				Hazard = 1;
+			}
+
+			Resource->WriteStages = Use->Stages;
+			Resource->WriteAccess = Use->Access & GraphWriteAccess;
+			Resource->ReadStages = 0;
+			Resource->ReadAccess = 0;
+		}
+		else
+		{
+			/* A use without access, like presenting, has nothing to wait for */
+			if(Resource->WriteStages != 0 && Use->Access != 0 && ((Use->Stages & ~Resource->ReadStages) ||
+				(Use->Access & ~Resource->ReadAccess)))
+			{
+				SourceStages |= Resource->WriteStages;
+				DestinationStages |= Use->Stages;
+				Memory.srcAccessMask |= Resource->WriteAccess;
+				Memory.dstAccessMask |= Use->Access;
+				Hazard = 1;
+			}
+
+			Resource->ReadStages |= Use->Stages;
+			Resource->ReadAccess |= Use->Access;
+		}
+
+		if(Use->Layout != VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			Resource->Layout = Use->Layout;
+		}
+
+		if(Use->FinalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			Resource->Layout = Use->FinalLayout;
+		}
+	}
+
+	if(!Hazard && ImageCount == 0)
+	{
+		return;
+	}
+
+	vkCmdPipelineBarrier(CommandBuffer,
+		SourceStages ? SourceStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		DestinationStages ? DestinationStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		Memory.srcAccessMask ? 1 : 0, &Memory, 0, NULL, ImageCount, Graph->Barriers);
+}
+
+
+void
+GraphExecute(
+	RenderGraph* Graph,
+	VkCommandBuffer CommandBuffer
+	)
+{
+#ifndef NDEBUG
+	/* The memory placement only holds while no image outlives its passes */
+	for(uint32_t i = 0; i < Graph->ImageDeclared; ++i)
+	{
+		const GraphImage* Image = Graph->Images + i;
+
+		uint32_t FirstPass;
+		uint32_t LastPass;
+		GraphGetSpan(Graph, Image->Resource, &FirstPass, &LastPass);
+
+		AssertEQ(FirstPass >= Image->FirstPass && LastPass <= Image->LastPass, 1);
+	}
+#endif
+
+	for(uint32_t i = 0; i < Graph->PassCount; ++i)
+	{
+		const GraphPass* Pass = Graph->Passes + i;
+
+		GraphRecordBarriers(Graph, i, CommandBuffer);
+
+		if(Pass->Record)
+		{
+			Pass->Record(CommandBuffer, Pass->Data);
+		}
+	}
+}
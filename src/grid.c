@@ -0,0 +1,423 @@
+#include "../include/grid.h"
+#include "../include/debug.h"
+#include "../include/util.h"
+
+#include <math.h>
+#include <string.h>
+
+
+static int32_t
+GridCoord(
+	const Grid* Grid,
+	float Value
+	)
+{
+	return (int32_t) floorf(Value / Grid->Spacing);
+}
+
+
+static uint32_t
+GridHash(
+	int32_t X,
+	int32_t Y
+	)
+{
+	uint32_t Hash = (uint32_t) X * UINT32_C(0x8DA6B343) ^ (uint32_t) Y * UINT32_C(0xD8163841);
+	return Hash ^ (Hash >> 16);
+}
+
+
+static uint32_t
+GridFind(
+	const Grid* Grid,
+	int32_t X,
+	int32_t Y
+	)
+{
+	if(Grid->TableSize == 0)
+	{
+		return UINT32_MAX;
+	}
+
+	uint32_t Mask = Grid->TableSize - 1;
+	uint32_t Index = GridHash(X, Y) & Mask;
+
+	while(1)
+	{
+		uint32_t Cell = Grid->Table[Index];
+
+		if(Cell == UINT32_MAX)
+		{
+			return UINT32_MAX;
+		}
+
+		if(Grid->Cells[Cell].X == X && Grid->Cells[Cell].Y == Y)
+		{
+			return Cell;
+		}
+
+		Index = (Index + 1) & Mask;
+	}
+}
+
+
+static void
+GridLink(
+	Grid* Grid,
+	uint32_t Cell
+	)
+{
+	uint32_t Mask = Grid->TableSize - 1;
+	uint32_t Index = GridHash(Grid->Cells[Cell].X, Grid->Cells[Cell].Y) & Mask;
+
+	while(Grid->Table[Index] != UINT32_MAX)
+	{
+		Index = (Index + 1) & Mask;
+	}
+
+	Grid->Table[Index] = Cell;
+}
+
+
+static uint32_t
+GridGetCell(
+	Grid* Grid,
+	int32_t X,
+	int32_t Y
+	)
+{
+	uint32_t Cell = GridFind(Grid, X, Y);
+	if(Cell != UINT32_MAX)
+	{
+		return Cell;
+	}
+
+	Grid->Cells = GrowArray(Grid->Cells, &Grid->CellSize, Grid->CellCount, sizeof(*Grid->Cells));
+
+	Cell = Grid->CellCount++;
+
+	GridCell* NewCell = Grid->Cells + Cell;
+	NewCell->X = X;
+	NewCell->Y = Y;
+	NewCell->Entries = NULL;
+	NewCell->Count = 0;
+	NewCell->Size = 0;
+
+	/* Keep the table at most half full */
+	if(Grid->CellCount * 2 > Grid->TableSize)
+	{
+		free(Grid->Table);
+
+		Grid->TableSize = MAX(Grid->TableSize << 1, 128);
+		Grid->Table = malloc(sizeof(*Grid->Table) * Grid->TableSize);
+		AssertNEQ(Grid->Table, NULL);
+
+		memset(Grid->Table, 0xFF, sizeof(*Grid->Table) * Grid->TableSize);
+
+		for(uint32_t i = 0; i < Grid->CellCount; ++i)
+		{
+			GridLink(Grid, i);
+		}
+	}
+	else
+	{
+		GridLink(Grid, Cell);
+	}
+
+	return Cell;
+}
+
+
+static void
+GridAppend(
+	Grid* Grid,
+	uint32_t Cell,
+	const GridEntry* Entry
+	)
+{
+	GridCell* Target = Grid->Cells + Cell;
+
+	Target->Entries = GrowArray(Target->Entries, &Target->Size, Target->Count, sizeof(*Target->Entries));
+
+	Grid->Items[Entry->ID].Cell = Cell;
+	Grid->Items[Entry->ID].Slot = Target->Count;
+
+	Target->Entries[Target->Count++] = *Entry;
+}
+
+
+static void
+GridUnlink(
+	Grid* Grid,
+	uint32_t ID
+	)
+{
+	GridItem* Item = Grid->Items + ID;
+	GridCell* Source = Grid->Cells + Item->Cell;
+
+	GridEntry* Last = Source->Entries + --Source->Count;
+
+	if(Item->Slot != Source->Count)
+	{
+		Source->Entries[Item->Slot] = *Last;
+		Grid->Items[Last->ID].Slot = Item->Slot;
+	}
+
+	Item->Cell = UINT32_MAX;
+}
+
+
+static int
+GridIsLive(
+	const Grid* Grid,
+	uint32_t ID
+	)
+{
+	return ID < Grid->ItemSize && Grid->Items[ID].Cell != UINT32_MAX;
+}
+
+
+void
+GridInit(
+	Grid* Grid,
+	float CellSize
+	)
+{
+	memset(Grid, 0, sizeof(*Grid));
+	Grid->Spacing = CellSize;
+}
+
+
+void
+GridFree(
+	Grid* Grid
+	)
+{
+	for(uint32_t i = 0; i < Grid->CellCount; ++i)
+	{
+		free(Grid->Cells[i].Entries);
+	}
+
+	free(Grid->Cells);
+	free(Grid->Table);
+	free(Grid->Items);
+}
+
+
+void
+GridInsert(
+	Grid* Grid,
+	uint32_t ID,
+	float X,
+	float Y,
+	float HalfWidth,
+	float HalfHeight
+	)
+{
+	if(ID >= Grid->ItemSize)
+	{
+		uint32_t Size = Grid->ItemSize;
+		Grid->Items = GrowArray(Grid->Items, &Grid->ItemSize, ID, sizeof(*Grid->Items));
+
+		memset(Grid->Items + Size, 0xFF, sizeof(*Grid->Items) * (Grid->ItemSize - Size));
+	}
+
+	AssertEQ(Grid->Items[ID].Cell, UINT32_MAX);
+
+	Grid->MaxHalfWidth = MAX(Grid->MaxHalfWidth, HalfWidth);
+	Grid->MaxHalfHeight = MAX(Grid->MaxHalfHeight, HalfHeight);
+
+	GridEntry Entry = {0};
+	Entry.ID = ID;
+	Entry.X = X;
+	Entry.Y = Y;
+	Entry.HalfWidth = HalfWidth;
+	Entry.HalfHeight = HalfHeight;
+
+	GridAppend(Grid, GridGetCell(Grid, GridCoord(Grid, X), GridCoord(Grid, Y)), &Entry);
+}
+
+
+/*
+ * Only a move into another cell touches the cell arrays, everything else
+ * just updates the entry in place.
+ */
+void
+GridMove(
+	Grid* Grid,
+	uint32_t ID,
+	float X,
+	float Y
+	)
+{
+	if(!GridIsLive(Grid, ID))
+	{
+		return;
+	}
+
+	GridItem* Item = Grid->Items + ID;
+	GridCell* Source = Grid->Cells + Item->Cell;
+	GridEntry* Entry = Source->Entries + Item->Slot;
+
+	int32_t CellX = GridCoord(Grid, X);
+	int32_t CellY = GridCoord(Grid, Y);
+
+	Entry->X = X;
+	Entry->Y = Y;
+
+	if(CellX == Source->X && CellY == Source->Y)
+	{
+		return;
+	}
+
+	GridEntry Moved = *Entry;
+
+	GridUnlink(Grid, ID);
+	GridAppend(Grid, GridGetCell(Grid, CellX, CellY), &Moved);
+}
+
+
+void
+GridRemove(
+	Grid* Grid,
+	uint32_t ID
+	)
+{
+	if(!GridIsLive(Grid, ID))
+	{
+		return;
+	}
+
+	GridUnlink(Grid, ID);
+}
+
+
+void
+GridBeginCells(
+	const Grid* Grid,
+	float MinX,
+	float MinY,
+	float MaxX,
+	float MaxY,
+	GridCells* Cells
+	)
+{
+	Cells->Grid = Grid;
+	Cells->MinX = GridCoord(Grid, MinX - Grid->MaxHalfWidth);
+	Cells->MinY = GridCoord(Grid, MinY - Grid->MaxHalfHeight);
+	Cells->MaxX = GridCoord(Grid, MaxX + Grid->MaxHalfWidth);
+	Cells->MaxY = GridCoord(Grid, MaxY + Grid->MaxHalfHeight);
+	Cells->X = Cells->MinX;
+	Cells->Y = Cells->MinX > Cells->MaxX ? Cells->MaxY + 1 : Cells->MinY;
+	Cells->Cell = 0;
+
+	/* A rectangle covering more cells than exist is cheaper to scan for */
+	uint64_t Area =
+		(uint64_t) MAX(Cells->MaxX - Cells->MinX + 1, 0) *
+		(uint64_t) MAX(Cells->MaxY - Cells->MinY + 1, 0);
+
+	Cells->Scan = Area > Grid->CellCount;
+}
+
+
+const GridCell*
+GridNextCell(
+	GridCells* Cells
+	)
+{
+	const Grid* Grid = Cells->Grid;
+
+	if(Cells->Scan)
+	{
+		while(Cells->Cell < Grid->CellCount)
+		{
+			const GridCell* Cell = Grid->Cells + Cells->Cell++;
+
+			if(
+				Cell->Count != 0 &&
+				Cell->X >= Cells->MinX && Cell->X <= Cells->MaxX &&
+				Cell->Y >= Cells->MinY && Cell->Y <= Cells->MaxY
+				)
+			{
+				return Cell;
+			}
+		}
+
+		return NULL;
+	}
+
+	while(Cells->Y <= Cells->MaxY)
+	{
+		uint32_t Cell = GridFind(Grid, Cells->X, Cells->Y);
+
+		if(Cells->X++ == Cells->MaxX)
+		{
+			Cells->X = Cells->MinX;
+			++Cells->Y;
+		}
+
+		if(Cell != UINT32_MAX && Grid->Cells[Cell].Count != 0)
+		{
+			return Grid->Cells + Cell;
+		}
+	}
+
+	return NULL;
+}
+
+
+int
+GridOverlaps(
+	const GridEntry* Entry,
+	float MinX,
+	float MinY,
+	float MaxX,
+	float MaxY
+	)
+{
+	return
+		Entry->X + Entry->HalfWidth >= MinX && Entry->X - Entry->HalfWidth <= MaxX &&
+		Entry->Y + Entry->HalfHeight >= MinY && Entry->Y - Entry->HalfHeight <= MaxY;
+}
+
+
+uint32_t
+GridQuery(
+	const Grid* Grid,
+	float MinX,
+	float MinY,
+	float MaxX,
+	float MaxY,
+	uint32_t* IDs,
+	uint32_t Capacity
+	)
+{
+	GridCells Cells;
+	GridBeginCells(Grid, MinX, MinY, MaxX, MaxY, &Cells);
+
+	uint32_t Count = 0;
+	const GridCell* Cell;
+
+	while((Cell = GridNextCell(&Cells)) != NULL)
+	{
+		const GridEntry* Entry = Cell->Entries;
+		const GridEntry* EntryEnd = Cell->Entries + Cell->Count;
+
+		for(; Entry != EntryEnd; ++Entry)
+		{
+			if(!GridOverlaps(Entry, MinX, MinY, MaxX, MaxY))
+			{
+				continue;
+			}
+
+			if(Count < Capacity)
+			{
+				IDs[Count] = Entry->ID;
+			}
+
+			++Count;
+		}
+	}
+
+	return Count;
+}
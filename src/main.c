@@ -9,9 +9,9 @@ main(
 {
 	VulkanInit();
 
-	VulkanRun();
+	int Status = VulkanRun();
 
 	VulkanFree();
 
-	return 0;
+	return Status;
 }
@@ -0,0 +1,180 @@
+#include "../include/record.h"
+#include "../include/debug.h"
+#include "../include/util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+int
+RecordCreate(
+	RecordLog* Log,
+	const char* Path,
+	const RecordHeader* Header
+	)
+{
+	*Log = (RecordLog){0};
+
+	Log->File = fopen(Path, "wb");
+	if(Log->File == NULL)
+	{
+		return -1;
+	}
+
+	Log->Header = *Header;
+	Log->Header.Magic = RECORD_MAGIC;
+	Log->Header.Version = RECORD_VERSION;
+
+	if(fwrite(&Log->Header, sizeof(Log->Header), 1, Log->File) != 1)
+	{
+		RecordClose(Log);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int
+RecordOpen(
+	RecordLog* Log,
+	const char* Path
+	)
+{
+	*Log = (RecordLog){0};
+
+	Log->File = fopen(Path, "rb");
+	if(Log->File == NULL)
+	{
+		return -1;
+	}
+
+	if(
+		fread(&Log->Header, sizeof(Log->Header), 1, Log->File) != 1 ||
+		Log->Header.Magic != RECORD_MAGIC ||
+		Log->Header.Version != RECORD_VERSION
+		)
+	{
+		RecordClose(Log);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+void
+RecordClose(
+	RecordLog* Log
+	)
+{
+	if(Log->File != NULL)
+	{
+		fclose(Log->File);
+	}
+
+	free(Log->Sprites);
+	free(Log->Written);
+	free(Log->Slots);
+
+	*Log = (RecordLog){0};
+}
+
+
+void
+RecordSetSprite(
+	RecordLog* Log,
+	uint32_t ID,
+	float X,
+	float Y,
+	float Rotation
+	)
+{
+	if(ID >= Log->WrittenSize)
+	{
+		uint32_t Size = Log->WrittenSize;
+		Log->Written = GrowArray(Log->Written, &Log->WrittenSize, ID, sizeof(*Log->Written));
+
+		Log->Slots = realloc(Log->Slots, sizeof(*Log->Slots) * Log->WrittenSize);
+		AssertNEQ(Log->Slots, NULL);
+
+		for(uint32_t i = Size; i < Log->WrittenSize; ++i)
+		{
+			Log->Written[i].ID = UINT32_MAX;
+			Log->Slots[i] = UINT32_MAX;
+		}
+	}
+
+	RecordSprite Sprite = {0};
+	Sprite.ID = ID;
+	Sprite.X = X;
+	Sprite.Y = Y;
+	Sprite.Rotation = Rotation;
+
+	RecordSprite* Written = Log->Written + ID;
+
+	if(Written->ID == ID && Written->X == X && Written->Y == Y && Written->Rotation == Rotation)
+	{
+		return;
+	}
+
+	*Written = Sprite;
+
+	/* A sprite changed twice in one frame only keeps its last values */
+	uint32_t Slot = Log->Slots[ID];
+
+	if(Slot < Log->Frame.SpriteCount && Log->Sprites[Slot].ID == ID)
+	{
+		Log->Sprites[Slot] = Sprite;
+		return;
+	}
+
+	Log->Sprites = GrowArray(Log->Sprites, &Log->SpriteSize, Log->Frame.SpriteCount, sizeof(*Log->Sprites));
+	Log->Slots[ID] = Log->Frame.SpriteCount;
+	Log->Sprites[Log->Frame.SpriteCount++] = Sprite;
+}
+
+
+int
+RecordWrite(
+	RecordLog* Log
+	)
+{
+	int Failed =
+		fwrite(&Log->Frame, sizeof(Log->Frame), 1, Log->File) != 1 ||
+		fwrite(Log->Sprites, sizeof(*Log->Sprites), Log->Frame.SpriteCount, Log->File) != Log->Frame.SpriteCount;
+
+	Log->Frame.SpriteCount = 0;
+	++Log->Frames;
+
+	return Failed ? -1 : 0;
+}
+
+
+int
+RecordRead(
+	RecordLog* Log
+	)
+{
+	if(fread(&Log->Frame, sizeof(Log->Frame), 1, Log->File) != 1)
+	{
+		return 0;
+	}
+
+	/* A count this large only comes from a cut or corrupt log */
+	if(Log->Frame.SpriteCount > RECORD_MAX_SPRITES)
+	{
+		return 0;
+	}
+
+	Log->Sprites = GrowArray(Log->Sprites, &Log->SpriteSize, Log->Frame.SpriteCount, sizeof(*Log->Sprites));
+
+	if(fread(Log->Sprites, sizeof(*Log->Sprites), Log->Frame.SpriteCount, Log->File) != Log->Frame.SpriteCount)
+	{
+		return 0;
+	}
+
+	++Log->Frames;
+
+	return 1;
+}
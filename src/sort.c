@@ -0,0 +1,79 @@
+#include "../include/sort.h"
+
+#include <string.h>
+
+
+void
+RadixSort(
+	uint64_t* Keys,
+	uint32_t* Values,
+	uint64_t* TempKeys,
+	uint32_t* TempValues,
+	uint32_t Count
+	)
+{
+	if(Count < 2)
+	{
+		return;
+	}
+
+	uint32_t Histograms[8][256] = {0};
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		uint64_t Key = Keys[i];
+
+		for(uint32_t Pass = 0; Pass < 8; ++Pass)
+		{
+			++Histograms[Pass][(Key >> (Pass * 8)) & 0xFF];
+		}
+	}
+
+	uint64_t* SrcKeys = Keys;
+	uint32_t* SrcValues = Values;
+	uint64_t* DstKeys = TempKeys;
+	uint32_t* DstValues = TempValues;
+
+	for(uint32_t Pass = 0; Pass < 8; ++Pass)
+	{
+		uint32_t* Histogram = Histograms[Pass];
+		uint32_t Shift = Pass * 8;
+
+		/* Every key has the same byte here, the pass would not move anything */
+		if(Histogram[(SrcKeys[0] >> Shift) & 0xFF] == Count)
+		{
+			continue;
+		}
+
+		uint32_t Offset = 0;
+
+		for(uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t Bucket = Histogram[i];
+			Histogram[i] = Offset;
+			Offset += Bucket;
+		}
+
+		for(uint32_t i = 0; i < Count; ++i)
+		{
+			uint32_t Index = Histogram[(SrcKeys[i] >> Shift) & 0xFF]++;
+
+			DstKeys[Index] = SrcKeys[i];
+			DstValues[Index] = SrcValues[i];
+		}
+
+		uint64_t* SwapKeys = SrcKeys;
+		SrcKeys = DstKeys;
+		DstKeys = SwapKeys;
+
+		uint32_t* SwapValues = SrcValues;
+		SrcValues = DstValues;
+		DstValues = SwapValues;
+	}
+
+	if(SrcKeys != Keys)
+	{
+		memcpy(Keys, SrcKeys, sizeof(*Keys) * Count);
+		memcpy(Values, SrcValues, sizeof(*Values) * Count);
+	}
+}
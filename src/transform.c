@@ -0,0 +1,238 @@
+#include "../include/transform.h"
+#include "../include/debug.h"
+#include "../include/util.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void*
+TransformsGrow(
+	void* Array,
+	uint32_t Size,
+	uint32_t ElementSize
+	)
+{
+	Array = realloc(Array, (size_t) Size * ElementSize);
+	AssertNEQ(Array, NULL);
+
+	return Array;
+}
+
+
+void
+TransformsInit(
+	Transforms* Transforms
+	)
+{
+	memset(Transforms, 0, sizeof(*Transforms));
+}
+
+
+void
+TransformsFree(
+	Transforms* Transforms
+	)
+{
+	free(Transforms->Parent);
+	free(Transforms->Dirty);
+	free(Transforms->X);
+	free(Transforms->Y);
+	free(Transforms->Rotation);
+	free(Transforms->WorldX);
+	free(Transforms->WorldY);
+	free(Transforms->WorldRotation);
+	free(Transforms->WorldCos);
+	free(Transforms->WorldSin);
+	free(Transforms->Updated);
+	free(Transforms->BatchRotation);
+	free(Transforms->BatchCos);
+	free(Transforms->BatchSin);
+}
+
+
+uint32_t
+TransformAdd(
+	Transforms* Transforms,
+	uint32_t Parent,
+	float X,
+	float Y,
+	float Rotation
+	)
+{
+	AssertEQ(Parent == TRANSFORM_ROOT || Parent < Transforms->Count, 1);
+
+	if(Transforms->Count == Transforms->Size)
+	{
+		uint32_t Size = Transforms->Size;
+
+		/* The first array picks the new size, the others follow it */
+		Transforms->Parent = GrowArray(Transforms->Parent, &Size, Transforms->Count, sizeof(uint32_t));
+		Transforms->Dirty = TransformsGrow(Transforms->Dirty, Size, sizeof(uint8_t));
+		Transforms->X = TransformsGrow(Transforms->X, Size, sizeof(float));
+		Transforms->Y = TransformsGrow(Transforms->Y, Size, sizeof(float));
+		Transforms->Rotation = TransformsGrow(Transforms->Rotation, Size, sizeof(float));
+		Transforms->WorldX = TransformsGrow(Transforms->WorldX, Size, sizeof(float));
+		Transforms->WorldY = TransformsGrow(Transforms->WorldY, Size, sizeof(float));
+		Transforms->WorldRotation = TransformsGrow(Transforms->WorldRotation, Size, sizeof(float));
+		Transforms->WorldCos = TransformsGrow(Transforms->WorldCos, Size, sizeof(float));
+		Transforms->WorldSin = TransformsGrow(Transforms->WorldSin, Size, sizeof(float));
+		Transforms->Updated = TransformsGrow(Transforms->Updated, Size, sizeof(uint32_t));
+		Transforms->BatchRotation = TransformsGrow(Transforms->BatchRotation, Size, sizeof(float));
+		Transforms->BatchCos = TransformsGrow(Transforms->BatchCos, Size, sizeof(float));
+		Transforms->BatchSin = TransformsGrow(Transforms->BatchSin, Size, sizeof(float));
+
+		Transforms->Size = Size;
+	}
+
+	uint32_t Index = Transforms->Count++;
+
+	Transforms->Parent[Index] = Parent;
+	Transforms->Dirty[Index] = 1;
+	Transforms->X[Index] = X;
+	Transforms->Y[Index] = Y;
+	Transforms->Rotation[Index] = Rotation;
+
+	return Index;
+}
+
+
+void
+TransformSet(
+	Transforms* Transforms,
+	uint32_t Index,
+	float X,
+	float Y,
+	float Rotation
+	)
+{
+	Transforms->Dirty[Index] = 1;
+	Transforms->X[Index] = X;
+	Transforms->Y[Index] = Y;
+	Transforms->Rotation[Index] = Rotation;
+}
+
+
+/*
+ * Sine and cosine of a whole batch. The angle is brought into a quarter turn
+ * around zero and both come from short polynomials, picked and negated by
+ * the quadrant. Without calls into libm and with selects instead of branches
+ * the loop vectorizes at -O3. The error stays below 1e-6 for angles up to
+ * ten thousand radians.
+ */
+static void
+TransformsSinCos(
+	const float* restrict Rotation,
+	float* restrict Cos,
+	float* restrict Sin,
+	uint32_t Count
+	)
+{
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		float Turns = Rotation[i] * 0.636619772f;
+		int32_t Quadrant = (int32_t) (Turns + (Turns < 0.0f ? -0.5f : 0.5f));
+
+		/* Pi/2 split in two so the reduction keeps its precision */
+		float R = Rotation[i] - (float) Quadrant * 1.5703125f;
+		R = R - (float) Quadrant * 4.83826794e-4f;
+
+		float R2 = R * R;
+		float S = R + R * R2 * (-1.66666546e-1f + R2 * (8.33216087e-3f + R2 * -1.95152959e-4f));
+		float C = 1.0f + R2 * (-0.5f + R2 * (4.16664568e-2f + R2 * (-1.38873163e-3f + R2 * 2.44331571e-5f)));
+
+		int32_t Swap = Quadrant & 1;
+		float SinR = Swap ? C : S;
+		float CosR = Swap ? S : C;
+
+		Sin[i] = Quadrant & 2 ? -SinR : SinR;
+		Cos[i] = (Quadrant + 1) & 2 ? -CosR : CosR;
+	}
+}
+
+
+/*
+ * Dirty flags are pushed down and the dirty entries gathered first, then
+ * each stage runs over the whole batch. The rotation and position stages
+ * read their parent and stay scalar. The trigonometry in between has no
+ * dependencies and is where most of the time goes, so it runs over dense
+ * copies of the batch's rotations and is scattered back afterwards.
+ */
+uint32_t
+TransformsUpdate(
+	Transforms* Transforms
+	)
+{
+	const uint32_t* Parent = Transforms->Parent;
+	uint8_t* Dirty = Transforms->Dirty;
+	uint32_t* Updated = Transforms->Updated;
+
+	uint32_t Count = 0;
+
+	for(uint32_t i = 0; i < Transforms->Count; ++i)
+	{
+		if(Parent[i] != TRANSFORM_ROOT)
+		{
+			Dirty[i] |= Dirty[Parent[i]];
+		}
+
+		if(Dirty[i])
+		{
+			Updated[Count++] = i;
+		}
+	}
+
+	float* BatchRotation = Transforms->BatchRotation;
+	float* BatchCos = Transforms->BatchCos;
+	float* BatchSin = Transforms->BatchSin;
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		uint32_t Index = Updated[i];
+		uint32_t Up = Parent[Index];
+
+		float Rotation = Transforms->Rotation[Index] +
+			(Up != TRANSFORM_ROOT ? Transforms->WorldRotation[Up] : 0.0f);
+
+		Transforms->WorldRotation[Index] = Rotation;
+		BatchRotation[i] = Rotation;
+	}
+
+	TransformsSinCos(BatchRotation, BatchCos, BatchSin, Count);
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		uint32_t Index = Updated[i];
+
+		Transforms->WorldCos[Index] = BatchCos[i];
+		Transforms->WorldSin[Index] = BatchSin[i];
+	}
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		uint32_t Index = Updated[i];
+		uint32_t Up = Parent[Index];
+
+		float X = Transforms->X[Index];
+		float Y = Transforms->Y[Index];
+
+		if(Up == TRANSFORM_ROOT)
+		{
+			Transforms->WorldX[Index] = X;
+			Transforms->WorldY[Index] = Y;
+		}
+		else
+		{
+			float Cos = Transforms->WorldCos[Up];
+			float Sin = Transforms->WorldSin[Up];
+
+			Transforms->WorldX[Index] = Transforms->WorldX[Up] + Cos * X - Sin * Y;
+			Transforms->WorldY[Index] = Transforms->WorldY[Up] + Sin * X + Cos * Y;
+		}
+
+		Dirty[Index] = 0;
+	}
+
+	return Count;
+}
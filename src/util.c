@@ -44,9 +44,11 @@ ReadFile(
 		return -1;
 	}
 
+	/* An empty file is usually one that is still being written */
 	struct stat Stat;
-	if(fstat(File, &Stat) == -1)
+	if(fstat(File, &Stat) == -1 || Stat.st_size == 0)
 	{
+		close(File);
 		return -1;
 	}
 
@@ -56,5 +58,40 @@ ReadFile(
 
 	ssize_t Bytes = read(File, *Buffer, *Length);
 	close(File);
-	return Bytes == *Length ? 0 : -1;
+
+	if(Bytes != *Length)
+	{
+		free(*Buffer);
+		*Buffer = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+void*
+GrowArray(
+	void* Array,
+	uint32_t* Size,
+	uint32_t Count,
+	size_t Element
+	)
+{
+	if(Count < *Size)
+	{
+		return Array;
+	}
+
+	*Size = MAX(*Size << 1, 8);
+
+	while(*Size <= Count)
+	{
+		*Size <<= 1;
+	}
+
+	Array = realloc(Array, Element * *Size);
+	AssertNEQ(Array, NULL);
+
+	return Array;
 }
@@ -1,6 +1,12 @@
 #include "../include/vulkan.h"
 #include "../include/debug.h"
 #include "../include/util.h"
+#include "../include/sort.h"
+#include "../include/grid.h"
+#include "../include/transform.h"
+#include "../include/font.h"
+#include "../include/graph.h"
+#include "../include/record.h"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -16,9 +22,18 @@
 
 #include <time.h>
 #include <string.h>
+#include <stddef.h>
+
+#ifdef __linux__
+	#include <poll.h>
+	#include <unistd.h>
+	#include <pthread.h>
+	#include <sys/inotify.h>
+#endif
 
 
 static GLFWwindow* Window;
+static int vkRefreshRate;
 
 
 static const char* vkInstanceExtensions[] =
@@ -48,10 +63,57 @@ static const char* vkDeviceExtensions[] =
 static uint32_t vkQueueID;
 static VkQueue vkQueue;
 
+/*
+ * One-off uploads go through a transfer only queue family when there is
+ * one. Everything they write is released to vkQueueID and acquired at the
+ * start of the next frame, which also waits for vkTransferSemaphore.
+ */
+static uint32_t vkTransferQueueID;
+static VkQueue vkTransferQueue;
+static VkSemaphore vkTransferSemaphore;
+static int vkTransferPending;
+
+/*
+ * With VULKAN_TIMELINE on a 1.2 device the fences go away. vkTransferSemaphore
+ * and vkFrameSemaphore become timeline semaphores, every submission signals
+ * the next value of its queue and waits name the value they need. The values
+ * are counted either way, the completed ones decide when retired objects go.
+ */
+static int vkTimeline;
+static VkSemaphore vkFrameSemaphore;
+static uint64_t vkFrameValue;
+static uint64_t vkTransferValue;
+static uint64_t vkFramesCompleted;
+static uint64_t vkUploadsCompleted;
+
+static VkImageMemoryBarrier* vkImageAcquires;
+static uint32_t vkImageAcquireCount;
+static uint32_t vkImageAcquireSize;
+
+static VkBufferMemoryBarrier* vkBufferAcquires;
+static uint32_t vkBufferAcquireCount;
+static uint32_t vkBufferAcquireSize;
+
+static const VkPipelineStageFlags vkAcquireStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+	VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
 
 static VkDevice vkDevice;
 static VkExtent2D vkExtent;
 static VkSampleCountFlagBits vkSamples;
+static VkSampleCountFlags vkSampleCounts;
+static VkBool32 vkSampleShading;
+static VkBool32 vkSampleShadingSupported;
+static VkBool32 vkScalingSupported;
+static uint32_t vkTimestampBits;
+static uint32_t vkApiVersion;
+static VkBool32 vkBindlessSupported;
+static VkBool32 vkTimelineSupported;
+static VkDeviceSize vkHostAlignment;
+static PFN_vkGetMemoryHostPointerPropertiesEXT vkGetMemoryHostPointerProperties;
+static int vkBindless;
+static int vkVertexPulling;
+static int vkStaticFrames;
 static VkPhysicalDeviceLimits vkLimits;
 static uint32_t vkMinImageCount;
 static VkSurfaceTransformFlagBitsKHR vkTransform;
@@ -65,6 +127,7 @@ static uint32_t vkImageCount;
 
 
 static VkCommandPool vkCommandPool;
+static VkCommandPool vkTransferCommandPool;
 static VkCommandBuffer vkCommandBuffer;
 static VkFence vkFence;
 static VkBuffer vkCopyBuffer;
@@ -72,6 +135,7 @@ static VkDeviceMemory vkCopyBufferMemory;
 
 
 static VkSampler vkSampler;
+static VkSampler vkFontSampler;
 
 typedef struct Image
 {
@@ -82,9 +146,142 @@ typedef struct Image
 }
 Image;
 
-static Image vkTexture;
-static Image vkDepthBuffer;
-static Image vkMultisampling;
+/*
+ * Every sprite sheet. The first one also provides the indexed texture and its
+ * palette. Instances pick a sheet with their Texture field, which only takes
+ * effect on the bindless path.
+ */
+static const char* vkTexturePaths[] =
+{
+	"textures/4x4x4.png"
+};
+
+static const uint32_t vkTextureSlots = 256;
+
+static Image vkTextures[ARRAYLEN(vkTexturePaths)];
+static Image vkIndexedTexture;
+static Image vkPalette;
+
+/*
+ * Text is drawn as ordinary instances flagged INSTANCE_SDF, so labels end
+ * up in the same batches as the sprites around them. Without a font the
+ * texture is a single empty layer and no text is drawn.
+ */
+static const char* vkFontPath = "fonts/DejaVuSansMono.ttf";
+static const float vkFontPixelHeight = 48.0f;
+
+static Font vkFont;
+static int vkFontLoaded;
+static Image vkFontTexture;
+
+static Image vkOffscreen;
+
+static RenderGraph vkGraph;
+
+/* Graph resources of the depth and multisampled color attachments */
+static uint32_t vkDepthAttachment;
+static uint32_t vkColorAttachment;
+
+
+typedef struct QualityTier
+{
+	const char* Name;
+	VkSampleCountFlagBits Samples;
+	VkBool32 SampleShading;
+}
+QualityTier;
+
+static const QualityTier vkQualities[] =
+{
+	{ "off", VK_SAMPLE_COUNT_1_BIT, VK_FALSE },
+	{ "2x", VK_SAMPLE_COUNT_2_BIT, VK_FALSE },
+	{ "2x sample shading", VK_SAMPLE_COUNT_2_BIT, VK_TRUE },
+	{ "4x", VK_SAMPLE_COUNT_4_BIT, VK_FALSE },
+	{ "4x sample shading", VK_SAMPLE_COUNT_4_BIT, VK_TRUE },
+	{ "8x", VK_SAMPLE_COUNT_8_BIT, VK_FALSE },
+	{ "8x sample shading", VK_SAMPLE_COUNT_8_BIT, VK_TRUE }
+};
+
+static const uint32_t vkQualityStart = 1;
+
+static uint32_t vkQuality;
+static uint32_t vkQualityCeiling = ARRAYLEN(vkQualities);
+static int vkQualityStep;
+
+
+static const uint32_t vkScaleSteps = 8;
+static const uint32_t vkScaleMin = 4;
+static const uint32_t vkScaleCooldown = 32;
+
+static int vkScaling;
+static int vkScalingToggle;
+static uint32_t vkScale;
+static uint32_t vkScaleWait;
+static VkExtent2D vkRenderExtent;
+
+static VkQueryPool vkQueryPool;
+static double vkFrameTime;
+
+/*
+ * Vertex shader invocations, clipping primitives and fragment shader
+ * invocations of the last frame read back, in that order.
+ */
+static int vkStatisticsSupported;
+static VkQueryPool vkStatisticsPool;
+static uint64_t vkStatistics[3];
+
+/*
+ * Regression run, started by VULKAN_GOLDEN naming a directory of reference
+ * images and/or VULKAN_BASELINE naming a frame-time baseline. Every scene is
+ * rendered from a fixed sequence of frames with a fixed simulation step, so
+ * the output only depends on the driver. A missing reference fails the run,
+ * VULKAN_CHECK_UPDATE writes every reference from this run instead.
+ */
+typedef struct CheckScene
+{
+	const char* Name;
+	uint32_t Quality;
+	uint32_t Scale;
+	int HeatMap;
+}
+CheckScene;
+
+static const CheckScene vkCheckScenes[] =
+{
+	{ "plain", 0, 0, 0 },
+	{ "msaa4", 3, 0, 0 },
+	{ "msaa4-shading", 4, 0, 0 },
+	{ "scaled", 0, 6, 0 },
+	{ "heatmap", 0, 0, 1 }
+};
+
+static const uint32_t vkCheckWarmup = 16;
+static const uint32_t vkCheckFrames = 128;
+static const double vkCheckStep = 1.0 / 60.0;
+static const uint32_t vkGoldenTolerance = 8;
+static const double vkGoldenMismatch = 0.001;
+static const double vkBaselineSlack = 0.1;
+static const VkExtent2D vkCheckExtent = { 1280, 720 };
+static const uint32_t vkCheckImages = 3;
+
+static int vkChecking;
+static int vkCheckUpdate;
+static Image* vkHeadlessImages;
+static int vkCapturing;
+static VkBuffer vkCaptureBuffer;
+static VkDeviceMemory vkCaptureMemory;
+static uint8_t* vkCaptureData;
+
+/*
+ * VULKAN_RECORD names a log that the input of every frame is written to,
+ * VULKAN_REPLAY one that is fed back in place of the keyboard and the clock
+ * as fast as the frames render. Both start from cleared particles.
+ */
+static RecordLog vkLog;
+static int vkLogging;
+static int vkReplaying;
+static double vkReplayTime;
+static double vkReplayRecordedTime;
 
 
 typedef struct VkVertexVertexInput
@@ -112,19 +309,202 @@ typedef struct VkVertexInstanceInput
 	vec2 Dimensions;
 	float Rotation;
 	uint32_t TexIndex;
+	uint32_t Palette; /* 0 samples the sheet's own colors, N samples vkIndexedTexture through palette N - 1 */
+	uint32_t Texture; /* index into vkTexturePaths */
+	uint32_t Color; /* RGBA8, multiplies whatever was sampled */
+	uint32_t Flags;
 }
 VkVertexInstanceInput;
 
+typedef enum InstanceFlag
+{
+	INSTANCE_SDF = 1, /* TexIndex is a glyph layer of vkFontTexture */
+}
+InstanceFlag;
+
 static const VkVertexInstanceInput vkVertexInstanceInput[] =
 {
-	{ { 0.0f, 0.0f, -50.0f }, { 50.0f, 50.0f }, 0, 0 },
-	{ { 0.0f, 0.0f, -1.0f }, { 1.0f, 1.0f }, 0, 1 },
-	{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f }, 1, 2 },
-	{ { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f }, 2, 3 },
+	{ { 0.0f, 0.0f, -50.0f }, { 50.0f, 50.0f }, 0, 0, 0, 0, UINT32_MAX, 0 },
+	{ { 0.0f, 0.0f, -1.0f }, { 1.0f, 1.0f }, 0, 1, 0, 0, UINT32_MAX, 0 },
+	{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f }, 1, 2, 0, 0, UINT32_MAX, 0 },
+	{ { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f }, 2, 3, 1, 0, UINT32_MAX, 0 },
+};
+
+
+
+typedef enum BlendMode
+{
+	BLEND_ALPHA,
+	BLEND_ADDITIVE,
+	kBLEND
+}
+BlendMode;
+
+/* The debug pipelines sit behind the blend modes in the same array */
+enum
+{
+	PIPELINE_HEAT = kBLEND,
+	PIPELINE_HEAT_MAP,
+	kPIPELINE
+};
+
+typedef struct Sprite
+{
+	VkVertexInstanceInput Instance;
+	uint8_t Layer;
+	uint8_t Blend;
+}
+Sprite;
+
+/*
+ * A run of sorted sprites that share a pipeline and a descriptor set, drawn
+ * with one instanced draw.
+ */
+typedef struct Batch
+{
+	uint32_t Blend;
+	uint32_t Descriptor;
+	uint32_t First;
+	uint32_t Count;
+}
+Batch;
+
+/* Starting size of every frame's instance buffer, it doubles when a frame needs more */
+static const uint32_t vkInstanceCapacity = 65536;
+
+static Sprite* vkSprites;
+static uint32_t vkSpriteCount;
+static uint32_t vkSpriteSize;
+
+static uint64_t* vkSortKeys;
+static uint32_t* vkSortValues;
+
+static Batch* vkBatches;
+static uint32_t vkBatchCount;
+
+/*
+ * Scene sprites are indexed by a grid keyed on their center, the view
+ * rectangle is in world units and only sprites in cells it touches are
+ * pushed to the draw list. Each sprite is driven by the transform with
+ * the same index.
+ */
+static const float vkGridSpacing = 16.0f;
+
+static Sprite vkScene[ARRAYLEN(vkVertexInstanceInput)];
+static Grid vkGrid;
+static Transforms vkTransforms;
+static float vkView[4] = { -64.0f, -64.0f, 64.0f, 64.0f };
+static float vkRotation;
+
+/*
+ * Static tiles live in chunks of vkChunkTiles squared. Every chunk owns a
+ * fixed range of one device local buffer holding its non-empty tiles as
+ * ready made instances, rebuilt only when a tile in it changes. At most
+ * vkChunkUploads chunks go up per frame through the frame's staging buffer.
+ */
+#define vkChunkTiles 32
+#define vkChunkUploads 8
+
+typedef struct TileChunk
+{
+	uint16_t Tiles[vkChunkTiles * vkChunkTiles]; /* 0 is empty, otherwise TexIndex + 1 */
+	uint32_t Count;
+	int Dirty;
+}
+TileChunk;
+
+static TileChunk* vkChunks;
+static uint32_t vkChunksX;
+static uint32_t vkChunksY;
+
+static uint32_t* vkDirtyChunks;
+static uint32_t vkDirtyChunkCount;
+
+static float vkTileOrigin[2] = { -128.0f, -128.0f };
+static float vkTileSize = 1.0f;
+static float vkTileDepth = -25.0f;
+static uint32_t vkTileSheet = 0;
+
+static VkBuffer vkTileBuffer;
+static VkDeviceMemory vkTileMemory;
+static VkDescriptorSet vkTileInstanceSet;
+
+/*
+ * Particles never leave the GPU. A compute pass respawns the slots right
+ * after vkParticleHead from the emitters, integrates everything alive and
+ * appends the survivors to an instance buffer whose count feeds an
+ * indirect draw, so the CPU only ever touches the emitters.
+ */
+typedef struct ParticleEmitter
+{
+	float Position[2];
+	float Velocity[2];
+	float Spread;
+	float Life;
+	float Rate; /* particles per second */
+	uint32_t TexIndex;
+	float Pending;
+}
+ParticleEmitter;
+
+typedef struct VkParticleEmitterInput
+{
+	float Position[2];
+	float Velocity[2];
+	float Spread;
+	float Life;
+	uint32_t Count;
+	uint32_t TexIndex;
+}
+VkParticleEmitterInput;
+
+typedef struct VkParticleConstantInput
+{
+	float Delta;
+	float Depth;
+	uint32_t Head;
+	uint32_t Capacity;
+	uint32_t EmitterCount;
+	uint32_t Seed;
+	VkParticleEmitterInput Emitters[3];
+}
+VkParticleConstantInput;
+
+typedef struct VkParticle
+{
+	float Position[2];
+	float Velocity[2];
+	float Life;
+	float Size;
+	uint32_t TexIndex;
+	uint32_t Color;
+}
+VkParticle;
+
+static const uint32_t vkParticleCapacity = 262144;
+static const float vkParticleDepth = 2.0f;
+
+static ParticleEmitter vkEmitters[] =
+{
+	{ { 0.0f, 0.0f }, { 0.0f, -2.0f }, 1.0f, 2.0f, 60000.0f, 0, 0.0f },
 };
 
-static VkBuffer vkVertexInstanceInputBuffer;
-static VkDeviceMemory vkVertexInstanceInputMemory;
+static uint32_t vkParticleHead;
+static int vkParticlesCleared;
+static double vkParticleTime;
+
+static VkBuffer vkParticleBuffer;
+static VkDeviceMemory vkParticleMemory;
+static VkBuffer vkParticleInstances;
+static VkDeviceMemory vkParticleInstanceMemory;
+static VkBuffer vkParticleIndirect;
+static VkDeviceMemory vkParticleIndirectMemory;
+
+static VkDescriptorSetLayout vkParticleDescriptors;
+static VkDescriptorPool vkParticleDescriptorPool;
+static VkPipelineLayout vkParticleLayout;
+static VkPipeline vkParticlePipeline;
+static VkDescriptorSet vkParticleInstanceSet;
 
 
 typedef struct VkVertexConstantInput
@@ -133,13 +513,46 @@ typedef struct VkVertexConstantInput
 }
 VkVertexConstantInput;
 
+/*
+ * Per frame inputs the shaders read from a buffer rather than push
+ * constants, so a recorded command buffer stays valid while they change.
+ * The particle block sits at the largest storage buffer offset alignment
+ * the spec allows.
+ */
+typedef struct VkFrameConstantInput
+{
+	VkVertexConstantInput Vertex;
+	uint8_t Padding[256 - sizeof(VkVertexConstantInput)];
+	VkParticleConstantInput Particles;
+}
+VkFrameConstantInput;
+
 
 static VkDescriptorSetLayout vkDescriptors;
+static VkDescriptorSetLayout vkInstanceDescriptors;
 static VkRenderPass vkRenderPass;
 static VkPipelineLayout vkPipelineLayout;
-static VkPipeline vkPipeline;
+static VkPipeline vkPipelines[kPIPELINE];
 static VkFramebuffer* vkFramebuffers;
 static VkDescriptorPool vkDescriptorPool;
+static VkDescriptorPool vkInstanceDescriptorPool;
+
+
+/*
+ * Opt-in overdraw view. The scene is drawn once more into vkHeatImage with
+ * every fragment adding one, and the scene pass then shows those counts as
+ * a color ramp instead of the sprites.
+ */
+static Image vkHeatImage;
+static VkRenderPass vkHeatRenderPass;
+static VkFramebuffer vkHeatFramebuffer;
+static VkDescriptorSetLayout vkHeatDescriptors;
+static VkDescriptorPool vkHeatDescriptorPool;
+static VkDescriptorSet vkHeatSet;
+static VkPipelineLayout vkHeatLayout;
+static int vkHeatMap;
+static int vkHeatMapToggle;
+static int vkHeatRecording;
 
 
 typedef enum Semaphore
@@ -157,13 +570,57 @@ typedef enum Fence
 }
 Fence;
 
+/*
+ * With VULKAN_STATIC every frame keeps a command buffer per swapchain image
+ * and submits it again while the generation and draw list key still match.
+ * The hash only rules recordings out quickly, a match is confirmed against
+ * the full key words.
+ */
+typedef struct VkRecording
+{
+	VkCommandBuffer CommandBuffer;
+	uint64_t Generation;
+	uint64_t Key;
+	uint32_t* Words;
+	uint32_t WordCount;
+	uint32_t WordSize;
+}
+VkRecording;
+
+static uint64_t vkRecordGeneration = 1;
+
+/* Key words of the frame being drawn */
+static uint32_t* vkRecordingWords;
+static uint32_t vkRecordingWordCount;
+static uint32_t vkRecordingWordSize;
+
 typedef struct VkFrame
 {
 	VkCommandBuffer CommandBuffer;
+	VkRecording* Recordings;
 	VkSemaphore Semaphores[kSEMAPHORE];
 	VkFence Fences[kFENCE];
-
-	VkDescriptorSet DescriptorSet;
+	uint64_t Value;
+
+	VkDescriptorSet DescriptorSets[ARRAYLEN(vkTexturePaths)];
+	int StaleDescriptors;
+
+	VkBuffer Instances;
+	VkDeviceMemory InstanceMemory;
+	VkVertexInstanceInput* InstanceData;
+	uint32_t InstanceCapacity;
+	VkDescriptorSet InstanceSet;
+	VkDescriptorSet ParticleSet;
+	int Timed;
+	int Counted;
+
+	VkBuffer Constants;
+	VkDeviceMemory ConstantMemory;
+	VkFrameConstantInput* ConstantData;
+
+	VkBuffer Staging;
+	VkDeviceMemory StagingMemory;
+	VkVertexInstanceInput* StagingData;
 }
 VkFrame;
 
@@ -236,11 +693,42 @@ VulkanDestroyDebugUtilsMessengerEXT(
 #endif /* NDEBUG */
 
 
+static void
+VulkanKeyCallback(
+	GLFWwindow* Window,
+	int Key,
+	int Scancode,
+	int Action,
+	int Mods
+	)
+{
+	if(Key == GLFW_KEY_Q && Action == GLFW_PRESS)
+	{
+		++vkQualityStep;
+	}
+
+	if(Key == GLFW_KEY_R && Action == GLFW_PRESS)
+	{
+		++vkScalingToggle;
+	}
+
+	if(Key == GLFW_KEY_H && Action == GLFW_PRESS)
+	{
+		++vkHeatMapToggle;
+	}
+}
+
+
 static void
 VulkanInitGLFW(
 	void
 	)
 {
+	if(vkChecking)
+	{
+		return;
+	}
+
 	int Success = glfwInit();
 	AssertEQ(Success, GLFW_TRUE);
 
@@ -253,6 +741,10 @@ VulkanInitGLFW(
 
 	Window = glfwCreateWindow(VideoMode->width, VideoMode->height, "2dpag", Monitor, NULL);
 	AssertNEQ(Window, NULL);
+
+	vkRefreshRate = VideoMode->refreshRate;
+
+	glfwSetKeyCallback(Window, VulkanKeyCallback);
 }
 
 
@@ -261,6 +753,11 @@ VulkanDestroyGLFW(
 	void
 	)
 {
+	if(vkChecking)
+	{
+		return;
+	}
+
 	glfwDestroyWindow(Window);
 	glfwTerminate();
 }
@@ -273,6 +770,19 @@ VulkanInitInstance(
 {
 	VkResult Result;
 
+	PFN_vkEnumerateInstanceVersion EnumerateInstanceVersion =
+		(PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(NULL, "vkEnumerateInstanceVersion");
+
+	vkApiVersion = VK_API_VERSION_1_0;
+
+	if(EnumerateInstanceVersion != NULL)
+	{
+		Result = EnumerateInstanceVersion(&vkApiVersion);
+		AssertEQ(Result, VK_SUCCESS);
+
+		vkApiVersion = MIN(vkApiVersion, VK_API_VERSION_1_2);
+	}
+
 	VkApplicationInfo AppInfo = {0};
 	AppInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 	AppInfo.pNext = NULL;
@@ -280,18 +790,23 @@ VulkanInitInstance(
 	AppInfo.applicationVersion = 0;
 	AppInfo.pEngineName = NULL;
 	AppInfo.engineVersion = 0;
-	AppInfo.apiVersion = VK_API_VERSION_1_0;
+	AppInfo.apiVersion = vkApiVersion;
 
 	VkInstanceCreateInfo CreateInfo = {0};
 	CreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	CreateInfo.flags = 0;
 	CreateInfo.pApplicationInfo = &AppInfo;
 
-	uint32_t GLFWExtensionCount;
-	const char** GLFWExtensions = glfwGetRequiredInstanceExtensions(&GLFWExtensionCount);
+	uint32_t GLFWExtensionCount = 0;
+	const char** GLFWExtensions = NULL;
+
+	if(!vkChecking)
+	{
+		GLFWExtensions = glfwGetRequiredInstanceExtensions(&GLFWExtensionCount);
+	}
 
 	uint32_t ExtensionCount = GLFWExtensionCount + ARRAYLEN(vkInstanceExtensions);
-	const char* Extensions[ExtensionCount];
+	const char* Extensions[ExtensionCount + 1];
 
 	const char** Extension = Extensions;
 	for(uint32_t i = 0; i < GLFWExtensionCount; ++i)
@@ -358,6 +873,11 @@ VulkanInitSurface(
 	void
 	)
 {
+	if(vkChecking)
+	{
+		return;
+	}
+
 	VkResult Result = glfwCreateWindowSurface(vkInstance, Window, NULL, &vkSurface);
 	AssertEQ(Result, VK_SUCCESS);
 }
@@ -368,6 +888,11 @@ VulkanDestroySurface(
 	void
 	)
 {
+	if(vkChecking)
+	{
+		return;
+	}
+
 	vkDestroySurfaceKHR(vkInstance, vkSurface, NULL);
 }
 
@@ -376,9 +901,18 @@ typedef struct VkDeviceScore
 {
 	uint32_t Score;
 	uint32_t QueueID;
+	uint32_t TransferQueueID;
 	uint32_t MinImageCount;
 	VkExtent2D Extent;
 	VkSampleCountFlagBits Samples;
+	VkSampleCountFlags SampleCounts;
+	VkBool32 SampleShading;
+	VkBool32 Statistics;
+	VkBool32 Blit;
+	VkBool32 Bindless;
+	VkBool32 Timeline;
+	VkDeviceSize HostAlignment;
+	uint32_t TimestampBits;
 	VkSurfaceTransformFlagBitsKHR Transform;
 	VkPhysicalDeviceLimits Limits;
 }
@@ -399,10 +933,8 @@ VulkanGetDeviceFeatures(
 		return 0;
 	}
 
-	if(!Features.sampleRateShading)
-	{
-		return 0;
-	}
+	DeviceScore->SampleShading = Features.sampleRateShading;
+	DeviceScore->Statistics = Features.pipelineStatisticsQuery;
 
 	return 1;
 }
@@ -426,15 +958,51 @@ VulkanGetDeviceQueues(
 
 	VkQueueFamilyProperties* Queue = Queues;
 
+	DeviceScore->TransferQueueID = UINT32_MAX;
+
+	/*
+	 * The uploads copy single rows at arbitrary offsets. A transfer family
+	 * with a coarser image granularity is skipped and the graphics family,
+	 * which always allows texel sized copies, does the uploads instead.
+	 */
 	for(uint32_t i = 0; i < QueueCount; ++i, ++Queue)
 	{
-		VkBool32 Present;
-		VkResult Result = vkGetPhysicalDeviceSurfaceSupportKHR(Device, i, vkSurface, &Present);
-		AssertEQ(Result, VK_SUCCESS);
+		VkExtent3D Granularity = Queue->minImageTransferGranularity;
+
+		if(
+			(Queue->queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+			!(Queue->queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+			Granularity.width == 1 && Granularity.height == 1 && Granularity.depth == 1
+			)
+		{
+			DeviceScore->TransferQueueID = i;
+			break;
+		}
+	}
+
+	Queue = Queues;
+
+	for(uint32_t i = 0; i < QueueCount; ++i, ++Queue)
+	{
+		VkBool32 Present = VK_TRUE;
+
+		if(!vkChecking)
+		{
+			VkResult Result = vkGetPhysicalDeviceSurfaceSupportKHR(Device, i, vkSurface, &Present);
+			AssertEQ(Result, VK_SUCCESS);
+		}
 
-		if(Present && (Queue->queueFlags & VK_QUEUE_GRAPHICS_BIT))
+		VkQueueFlags Flags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+
+		if(Present && (Queue->queueFlags & Flags) == Flags)
 		{
 			DeviceScore->QueueID = i;
+			DeviceScore->TimestampBits = Queue->timestampValidBits;
+
+			if(DeviceScore->TransferQueueID == UINT32_MAX)
+			{
+				DeviceScore->TransferQueueID = i;
+			}
 
 			return 1;
 		}
@@ -492,11 +1060,161 @@ VulkanGetDeviceExtensions(
 }
 
 
+static int
+VulkanHasDeviceExtension(
+	VkPhysicalDevice Device,
+	const char* Name
+	)
+{
+	uint32_t ExtensionCount;
+	vkEnumerateDeviceExtensionProperties(Device, NULL, &ExtensionCount, NULL);
+	if(ExtensionCount == 0)
+	{
+		return 0;
+	}
+
+	VkExtensionProperties Extensions[ExtensionCount];
+	vkEnumerateDeviceExtensionProperties(Device, NULL, &ExtensionCount, Extensions);
+
+	for(uint32_t i = 0; i < ExtensionCount; ++i)
+	{
+		if(strcmp(Name, Extensions[i].extensionName) == 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * Descriptor indexing needs the features2 query from Vulkan 1.1, which also
+ * covers the maintenance3 dependency of the extension.
+ */
+static int
+VulkanGetDeviceBindless(
+	VkPhysicalDevice Device,
+	VkDeviceScore* DeviceScore
+	)
+{
+	VkPhysicalDeviceProperties Properties;
+	vkGetPhysicalDeviceProperties(Device, &Properties);
+
+	if(vkApiVersion < VK_API_VERSION_1_1 || Properties.apiVersion < VK_API_VERSION_1_1)
+	{
+		return 1;
+	}
+
+	if(!VulkanHasDeviceExtension(Device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+	{
+		return 1;
+	}
+
+	/* The texture array plus the indexed sheet, its palette and the font */
+	if(MIN(Properties.limits.maxPerStageDescriptorSamplers,
+		Properties.limits.maxDescriptorSetSamplers) < vkTextureSlots + 3)
+	{
+		return 1;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeatures Indexing = {0};
+	Indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	Indexing.pNext = NULL;
+
+	VkPhysicalDeviceFeatures2 Features = {0};
+	Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	Features.pNext = &Indexing;
+
+	vkGetPhysicalDeviceFeatures2(Device, &Features);
+
+	DeviceScore->Bindless =
+		Indexing.runtimeDescriptorArray &&
+		Indexing.descriptorBindingPartiallyBound &&
+		Indexing.shaderSampledImageArrayNonUniformIndexing;
+
+	return 1;
+}
+
+
+static int
+VulkanGetDeviceTimeline(
+	VkPhysicalDevice Device,
+	VkDeviceScore* DeviceScore
+	)
+{
+	VkPhysicalDeviceProperties Properties;
+	vkGetPhysicalDeviceProperties(Device, &Properties);
+
+	if(vkApiVersion < VK_API_VERSION_1_2 || Properties.apiVersion < VK_API_VERSION_1_2)
+	{
+		return 1;
+	}
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures Timeline = {0};
+	Timeline.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	Timeline.pNext = NULL;
+
+	VkPhysicalDeviceFeatures2 Features = {0};
+	Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	Features.pNext = &Timeline;
+
+	vkGetPhysicalDeviceFeatures2(Device, &Features);
+
+	DeviceScore->Timeline = Timeline.timelineSemaphore;
+
+	return 1;
+}
+
+
+/*
+ * Host memory import is optional, HostAlignment stays 0 without it.
+ */
+static int
+VulkanGetDeviceHostImport(
+	VkPhysicalDevice Device,
+	VkDeviceScore* DeviceScore
+	)
+{
+	VkPhysicalDeviceProperties Properties;
+	vkGetPhysicalDeviceProperties(Device, &Properties);
+
+	if(vkApiVersion < VK_API_VERSION_1_1 || Properties.apiVersion < VK_API_VERSION_1_1)
+	{
+		return 1;
+	}
+
+	if(!VulkanHasDeviceExtension(Device, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME))
+	{
+		return 1;
+	}
+
+	VkPhysicalDeviceExternalMemoryHostPropertiesEXT Host = {0};
+	Host.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+	Host.pNext = NULL;
+
+	VkPhysicalDeviceProperties2 Properties2 = {0};
+	Properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	Properties2.pNext = &Host;
+
+	vkGetPhysicalDeviceProperties2(Device, &Properties2);
+
+	DeviceScore->HostAlignment = Host.minImportedHostPointerAlignment;
+
+	return 1;
+}
+
+
 static VkExtent2D
 VulkanGetExtent(
 	void
 	)
 {
+	if(vkChecking)
+	{
+		return vkCheckExtent;
+	}
+
 	int Width = 0;
 	int Height = 0;
 
@@ -535,6 +1253,31 @@ VulkanGetDeviceSwapChain(
 	VkDeviceScore* DeviceScore
 	)
 {
+	VkFormatProperties FormatProperties;
+	vkGetPhysicalDeviceFormatProperties(Device, VK_FORMAT_B8G8R8A8_SRGB, &FormatProperties);
+
+	VkFormatFeatureFlags BlitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+		VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+	/*
+	 * A check renders headless into images of its own at a fixed size, so
+	 * the references do not depend on the monitor it runs on.
+	 */
+	if(vkChecking)
+	{
+		if(!(FormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT))
+		{
+			return 0;
+		}
+
+		DeviceScore->Extent = vkCheckExtent;
+		DeviceScore->MinImageCount = vkCheckImages;
+		DeviceScore->Transform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+		DeviceScore->Blit = (FormatProperties.optimalTilingFeatures & BlitFeatures) == BlitFeatures;
+
+		return 1;
+	}
+
 	uint32_t FormatCount;
 	vkGetPhysicalDeviceSurfaceFormatsKHR(Device, vkSurface, &FormatCount, NULL);
 	if(FormatCount == 0)
@@ -572,6 +1315,10 @@ VulkanGetDeviceSwapChain(
 	);
 	DeviceScore->Transform = vkSurfaceCapabilities.currentTransform;
 
+	DeviceScore->Blit =
+		(vkSurfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+		(FormatProperties.optimalTilingFeatures & BlitFeatures) == BlitFeatures;
+
 	return 1;
 }
 
@@ -611,9 +1358,11 @@ VulkanGetDeviceProperties(
 	}
 	else
 	{
-		AssertEQ(0, 1);
+		DeviceScore->Samples = VK_SAMPLE_COUNT_1_BIT;
 	}
 
+	DeviceScore->SampleCounts = Counts;
+
 	DeviceScore->Score += DeviceScore->Samples * 16;
 	DeviceScore->Score += Properties.limits.maxImageDimension2D;
 	DeviceScore->Limits = Properties.limits;
@@ -654,6 +1403,21 @@ VulkanGetDeviceScore(
 		goto goto_err;
 	}
 
+	if(!VulkanGetDeviceBindless(Device, &DeviceScore))
+	{
+		goto goto_err;
+	}
+
+	if(!VulkanGetDeviceTimeline(Device, &DeviceScore))
+	{
+		goto goto_err;
+	}
+
+	if(!VulkanGetDeviceHostImport(Device, &DeviceScore))
+	{
+		goto goto_err;
+	}
+
 	return DeviceScore;
 
 
@@ -697,35 +1461,85 @@ VulkanInitDevice(
 	AssertNEQ(BestDevice, NULL);
 
 	vkQueueID = BestDeviceScore.QueueID;
+	vkTransferQueueID = BestDeviceScore.TransferQueueID;
 	vkExtent = BestDeviceScore.Extent;
-	vkSamples = BestDeviceScore.Samples;
+	vkRenderExtent = vkExtent;
+	vkScale = vkScaleSteps;
+	vkSampleCounts = BestDeviceScore.SampleCounts;
+	vkSampleShadingSupported = BestDeviceScore.SampleShading;
 	vkLimits = BestDeviceScore.Limits;
+	vkTimestampBits = BestDeviceScore.TimestampBits;
+	vkStatisticsSupported = BestDeviceScore.Statistics;
+	vkScalingSupported = BestDeviceScore.Blit && vkTimestampBits != 0;
+	vkBindlessSupported = BestDeviceScore.Bindless;
+	vkBindless = vkBindlessSupported && getenv("VULKAN_BINDLESS") != NULL;
+	vkTimelineSupported = BestDeviceScore.Timeline;
+	vkTimeline = vkTimelineSupported && getenv("VULKAN_TIMELINE") != NULL;
+	vkHostAlignment = BestDeviceScore.HostAlignment;
+	vkVertexPulling = getenv("VULKAN_VERTEX_PULLING") != NULL;
+	vkStaticFrames = getenv("VULKAN_STATIC") != NULL;
+
+	vkQuality = 0;
+	vkSamples = vkQualities[vkQuality].Samples;
+	vkSampleShading = vkQualities[vkQuality].SampleShading;
 
 
 	float Priority = 1.0f;
 
-	VkDeviceQueueCreateInfo Queue = {0};
-	Queue.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	Queue.pNext = NULL;
-	Queue.flags = 0;
-	Queue.queueFamilyIndex = vkQueueID;
-	Queue.queueCount = 1;
-	Queue.pQueuePriorities = &Priority;
+	VkDeviceQueueCreateInfo Queues[2] = {0};
+
+	for(uint32_t i = 0; i < ARRAYLEN(Queues); ++i)
+	{
+		Queues[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		Queues[i].pNext = NULL;
+		Queues[i].flags = 0;
+		Queues[i].queueFamilyIndex = i == 0 ? vkQueueID : vkTransferQueueID;
+		Queues[i].queueCount = 1;
+		Queues[i].pQueuePriorities = &Priority;
+	}
 
 	VkPhysicalDeviceFeatures DeviceFeatures = {0};
 	DeviceFeatures.samplerAnisotropy = VK_TRUE;
-	DeviceFeatures.sampleRateShading = VK_TRUE;
+	DeviceFeatures.sampleRateShading = vkSampleShadingSupported;
+	DeviceFeatures.pipelineStatisticsQuery = vkStatisticsSupported;
+
+	VkPhysicalDeviceDescriptorIndexingFeatures Indexing = {0};
+	Indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	Indexing.pNext = NULL;
+	Indexing.runtimeDescriptorArray = VK_TRUE;
+	Indexing.descriptorBindingPartiallyBound = VK_TRUE;
+	Indexing.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures Timeline = {0};
+	Timeline.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	Timeline.pNext = vkBindless ? &Indexing : NULL;
+	Timeline.timelineSemaphore = VK_TRUE;
+
+	const char* Extensions[ARRAYLEN(vkDeviceExtensions) + 2];
+	uint32_t ExtensionCount = ARRAYLEN(vkDeviceExtensions);
+
+	memcpy(Extensions, vkDeviceExtensions, sizeof(vkDeviceExtensions));
+
+	if(vkBindless)
+	{
+		Extensions[ExtensionCount++] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+	}
+
+	if(vkHostAlignment != 0)
+	{
+		Extensions[ExtensionCount++] = VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME;
+	}
 
 	VkDeviceCreateInfo CreateInfo = {0};
 	CreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	CreateInfo.pNext = NULL;
+	CreateInfo.pNext = vkTimeline ? &Timeline : Timeline.pNext;
 	CreateInfo.flags = 0;
-	CreateInfo.queueCreateInfoCount = 1;
-	CreateInfo.pQueueCreateInfos = &Queue;
+	CreateInfo.queueCreateInfoCount = vkTransferQueueID != vkQueueID ? 2 : 1;
+	CreateInfo.pQueueCreateInfos = Queues;
 	CreateInfo.enabledLayerCount = ARRAYLEN(vkLayers);
 	CreateInfo.ppEnabledLayerNames = vkLayers;
-	CreateInfo.enabledExtensionCount = ARRAYLEN(vkDeviceExtensions);
-	CreateInfo.ppEnabledExtensionNames = vkDeviceExtensions;
+	CreateInfo.enabledExtensionCount = ExtensionCount;
+	CreateInfo.ppEnabledExtensionNames = Extensions;
 	CreateInfo.pEnabledFeatures = &DeviceFeatures;
 
 	VkResult Result = vkCreateDevice(BestDevice, &CreateInfo, NULL, &vkDevice);
@@ -733,6 +1547,18 @@ VulkanInitDevice(
 
 
 	vkGetDeviceQueue(vkDevice, vkQueueID, 0, &vkQueue);
+	vkGetDeviceQueue(vkDevice, vkTransferQueueID, 0, &vkTransferQueue);
+
+	if(vkHostAlignment != 0)
+	{
+		vkGetMemoryHostPointerProperties = (PFN_vkGetMemoryHostPointerPropertiesEXT)
+			vkGetDeviceProcAddr(vkDevice, "vkGetMemoryHostPointerPropertiesEXT");
+
+		if(vkGetMemoryHostPointerProperties == NULL)
+		{
+			vkHostAlignment = 0;
+		}
+	}
 
 	vkMinImageCount = BestDeviceScore.MinImageCount;
 	vkTransform = BestDeviceScore.Transform;
@@ -765,7 +1591,8 @@ VulkanInitSwapchain(
 	CreateInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 	CreateInfo.imageExtent = vkExtent;
 	CreateInfo.imageArrayLayers = 1;
-	CreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	CreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+		(vkScalingSupported ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0);
 	CreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	CreateInfo.queueFamilyIndexCount = 0;
 	CreateInfo.pQueueFamilyIndices = NULL;
@@ -869,6 +1696,108 @@ VulkanDestroyFrames(
 }
 
 
+static void
+VulkanInitQueries(
+	void
+	)
+{
+	VkQueryPoolCreateInfo CreateInfo = {0};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	CreateInfo.pNext = NULL;
+	CreateInfo.flags = 0;
+	CreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	CreateInfo.queryCount = vkImageCount * 2;
+	CreateInfo.pipelineStatistics = 0;
+
+	VkResult Result;
+
+	if(vkTimestampBits != 0)
+	{
+		Result = vkCreateQueryPool(vkDevice, &CreateInfo, NULL, &vkQueryPool);
+		AssertEQ(Result, VK_SUCCESS);
+	}
+
+	if(vkStatisticsSupported)
+	{
+		CreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		CreateInfo.queryCount = vkImageCount;
+		CreateInfo.pipelineStatistics =
+			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+		Result = vkCreateQueryPool(vkDevice, &CreateInfo, NULL, &vkStatisticsPool);
+		AssertEQ(Result, VK_SUCCESS);
+	}
+}
+
+
+static void
+VulkanDestroyQueries(
+	void
+	)
+{
+	vkDestroyQueryPool(vkDevice, vkStatisticsPool, NULL);
+	vkDestroyQueryPool(vkDevice, vkQueryPool, NULL);
+}
+
+
+static VkSemaphore
+VulkanCreateTimeline(
+	void
+	)
+{
+	VkSemaphoreTypeCreateInfo TypeInfo = {0};
+	TypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	TypeInfo.pNext = NULL;
+	TypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	TypeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo SemaphoreInfo = {0};
+	SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	SemaphoreInfo.pNext = &TypeInfo;
+	SemaphoreInfo.flags = 0;
+
+	VkSemaphore Semaphore;
+	VkResult Result = vkCreateSemaphore(vkDevice, &SemaphoreInfo, NULL, &Semaphore);
+	AssertEQ(Result, VK_SUCCESS);
+
+	return Semaphore;
+}
+
+
+/*
+ * Most of the time the value was reached long ago and the counter query is
+ * all it takes, only a queue that is behind costs a blocking wait.
+ */
+static void
+VulkanWaitTimeline(
+	VkSemaphore Semaphore,
+	uint64_t Value
+	)
+{
+	uint64_t Current;
+	VkResult Result = vkGetSemaphoreCounterValue(vkDevice, Semaphore, &Current);
+	AssertEQ(Result, VK_SUCCESS);
+
+	if(Current >= Value)
+	{
+		return;
+	}
+
+	VkSemaphoreWaitInfo WaitInfo = {0};
+	WaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	WaitInfo.pNext = NULL;
+	WaitInfo.flags = 0;
+	WaitInfo.semaphoreCount = 1;
+	WaitInfo.pSemaphores = &Semaphore;
+	WaitInfo.pValues = &Value;
+
+	Result = vkWaitSemaphores(vkDevice, &WaitInfo, UINT64_MAX);
+	AssertEQ(Result, VK_SUCCESS);
+}
+
+
 static void
 VulkanInitCommands(
 	void
@@ -883,34 +1812,66 @@ VulkanInitCommands(
 	VkResult Result = vkCreateCommandPool(vkDevice, &PoolInfo, NULL, &vkCommandPool);
 	AssertEQ(Result, VK_SUCCESS);
 
+	PoolInfo.queueFamilyIndex = vkTransferQueueID;
+
+	Result = vkCreateCommandPool(vkDevice, &PoolInfo, NULL, &vkTransferCommandPool);
+	AssertEQ(Result, VK_SUCCESS);
 
-	VkCommandBuffer CommandBuffers[1 + vkImageCount];
 
 	VkCommandBufferAllocateInfo AllocInfo = {0};
 	AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	AllocInfo.pNext = NULL;
-	AllocInfo.commandPool = vkCommandPool;
+	AllocInfo.commandPool = vkTransferCommandPool;
 	AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	AllocInfo.commandBufferCount = 1;
+
+	Result = vkAllocateCommandBuffers(vkDevice, &AllocInfo, &vkCommandBuffer);
+	AssertEQ(Result, VK_SUCCESS);
+
+	uint32_t PerFrame = vkStaticFrames ? vkImageCount : 1;
+	VkCommandBuffer CommandBuffers[vkImageCount * PerFrame];
+
+	AllocInfo.commandPool = vkCommandPool;
 	AllocInfo.commandBufferCount = ARRAYLEN(CommandBuffers);
 
 	Result = vkAllocateCommandBuffers(vkDevice, &AllocInfo, CommandBuffers);
 	AssertEQ(Result, VK_SUCCESS);
 
-	vkCommandBuffer = CommandBuffers[0];
-
 	VkFrame* Frame = vkFrames;
-	VkCommandBuffer* CommandBuffer = CommandBuffers + 1;
+	VkCommandBuffer* CommandBuffer = CommandBuffers;
 
 	while(1)
 	{
 		Frame->CommandBuffer = *CommandBuffer;
+		Frame->Recordings = NULL;
+
+		if(vkStaticFrames)
+		{
+			Frame->Recordings = calloc(vkImageCount, sizeof(*Frame->Recordings));
+			AssertNEQ(Frame->Recordings, NULL);
+
+			for(uint32_t i = 0; i < vkImageCount; ++i)
+			{
+				Frame->Recordings[i].CommandBuffer = CommandBuffer[i];
+			}
+		}
 
 		if(++Frame == vkFrameEnd)
 		{
 			break;
 		}
 
-		++CommandBuffer;
+		CommandBuffer += PerFrame;
+	}
+
+	if(vkTimeline)
+	{
+		vkTransferSemaphore = VulkanCreateTimeline();
+		vkFrameSemaphore = VulkanCreateTimeline();
+		vkTransferValue = 0;
+		vkFrameValue = 0;
+
+		return;
 	}
 
 	VkFenceCreateInfo FenceInfo = {0};
@@ -920,6 +1881,14 @@ VulkanInitCommands(
 
 	Result = vkCreateFence(vkDevice, &FenceInfo, NULL, &vkFence);
 	AssertEQ(Result, VK_SUCCESS);
+
+	VkSemaphoreCreateInfo SemaphoreInfo = {0};
+	SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	SemaphoreInfo.pNext = NULL;
+	SemaphoreInfo.flags = 0;
+
+	Result = vkCreateSemaphore(vkDevice, &SemaphoreInfo, NULL, &vkTransferSemaphore);
+	AssertEQ(Result, VK_SUCCESS);
 }
 
 
@@ -928,26 +1897,50 @@ VulkanDestroyCommands(
 	void
 	)
 {
+	vkDestroySemaphore(vkDevice, vkFrameSemaphore, NULL);
+	vkDestroySemaphore(vkDevice, vkTransferSemaphore, NULL);
 	vkDestroyFence(vkDevice, vkFence, NULL);
 
+	free(vkBufferAcquires);
+	free(vkImageAcquires);
+	free(vkRecordingWords);
+
+	GraphFree(&vkGraph);
+
+	vkFreeCommandBuffers(vkDevice, vkTransferCommandPool, 1, &vkCommandBuffer);
+	vkDestroyCommandPool(vkDevice, vkTransferCommandPool, NULL);
+
 
-	VkCommandBuffer CommandBuffers[1 + vkImageCount];
-	CommandBuffers[0] = vkCommandBuffer;
+	uint32_t PerFrame = vkStaticFrames ? vkImageCount : 1;
+	VkCommandBuffer CommandBuffers[vkImageCount * PerFrame];
 
 	VkFrame* Frame = vkFrames;
 
-	VkCommandBuffer* CommandBuffer = CommandBuffers + 1;
+	VkCommandBuffer* CommandBuffer = CommandBuffers;
 
 	while(1)
 	{
-		*CommandBuffer = Frame->CommandBuffer;
+		if(Frame->Recordings != NULL)
+		{
+			for(uint32_t i = 0; i < vkImageCount; ++i)
+			{
+				CommandBuffer[i] = Frame->Recordings[i].CommandBuffer;
+				free(Frame->Recordings[i].Words);
+			}
+
+			free(Frame->Recordings);
+		}
+		else
+		{
+			*CommandBuffer = Frame->CommandBuffer;
+		}
 
 		if(++Frame == vkFrameEnd)
 		{
 			break;
 		}
 
-		++CommandBuffer;
+		CommandBuffer += PerFrame;
 	}
 
 	vkFreeCommandBuffers(vkDevice, vkCommandPool, ARRAYLEN(CommandBuffers), CommandBuffers);
@@ -982,6 +1975,15 @@ VulkanInitSampler(
 
 	VkResult Result = vkCreateSampler(vkDevice, &CreateInfo, NULL, &vkSampler);
 	AssertEQ(Result, VK_SUCCESS);
+
+	/* Distance fields only work when interpolated */
+	CreateInfo.magFilter = VK_FILTER_LINEAR;
+	CreateInfo.minFilter = VK_FILTER_LINEAR;
+	CreateInfo.anisotropyEnable = VK_FALSE;
+	CreateInfo.maxAnisotropy = 1.0f;
+
+	Result = vkCreateSampler(vkDevice, &CreateInfo, NULL, &vkFontSampler);
+	AssertEQ(Result, VK_SUCCESS);
 }
 
 
@@ -990,23 +1992,34 @@ VulkanDestroySampler(
 	void
 	)
 {
+	vkDestroySampler(vkDevice, vkFontSampler, NULL);
 	vkDestroySampler(vkDevice, vkSampler, NULL);
 }
 
 
-static VkShaderModule
-VulkanCreateShader(
-	const char* Path
+static int
+VulkanTryCreateShader(
+	const char* Path,
+	VkShaderModule* Shader
 	)
 {
 	uint64_t Size;
 	uint8_t* Buffer;
 
-	int Error = ReadFile(Path, &Size, &Buffer);
-	AssertEQ(Error, 0);
+	if(ReadFile(Path, &Size, &Buffer) == -1)
+	{
+		return -1;
+	}
 
+	/* SPIR-V is a stream of words starting with the magic number */
 	const uint32_t* Code = (const uint32_t*) Buffer;
 
+	if(Size % 4 != 0 || Code[0] != 0x07230203)
+	{
+		free(Buffer);
+		return -1;
+	}
+
 	VkShaderModuleCreateInfo CreateInfo = {0};
 	CreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	CreateInfo.pNext = NULL;
@@ -1014,12 +2027,23 @@ VulkanCreateShader(
 	CreateInfo.codeSize = Size;
 	CreateInfo.pCode = Code;
 
+	VkResult Result = vkCreateShaderModule(vkDevice, &CreateInfo, NULL, Shader);
+
+	free(Buffer);
+	return Result == VK_SUCCESS ? 0 : -1;
+}
+
+
+static VkShaderModule
+VulkanCreateShader(
+	const char* Path
+	)
+{
 	VkShaderModule Shader;
 
-	VkResult Result = vkCreateShaderModule(vkDevice, &CreateInfo, NULL, &Shader);
-	AssertEQ(Result, VK_SUCCESS);
+	int Error = VulkanTryCreateShader(Path, &Shader);
+	AssertEQ(Error, 0);
 
-	free(Buffer);
 	return Shader;
 }
 
@@ -1033,32 +2057,81 @@ VulkanDestroyShader(
 }
 
 
+/*
+ * Of the types that have every Required flag, takes the one with the most
+ * Preferred flags, then the fewest flags nobody asked for, then the largest
+ * heap. The middle rule keeps staging out of a small BAR heap on discrete
+ * GPUs, while on integrated ones every type is the same anyway.
+ */
 static uint32_t
-VulkanGetMemory(
+VulkanFindMemory(
 	uint32_t Bits,
-	VkMemoryPropertyFlags Properties
+	VkMemoryPropertyFlags Required,
+	VkMemoryPropertyFlags Preferred
 	)
 {
+	uint32_t Best = UINT32_MAX;
+	uint64_t BestScore = 0;
+
 	for(uint32_t i = 0; i < vkMemoryProperties.memoryTypeCount; ++i)
 	{
-		if(
-			(Bits & (1 << i)) &&
-			(vkMemoryProperties.memoryTypes[i].propertyFlags & Properties) == Properties
-			)
+		VkMemoryPropertyFlags Flags = vkMemoryProperties.memoryTypes[i].propertyFlags;
+		VkMemoryPropertyFlags Extra = Flags & ~(Required | Preferred);
+
+		if(!(Bits & (1 << i)) || (Flags & Required) != Required)
+		{
+			continue;
+		}
+
+		if(Extra & (VK_MEMORY_PROPERTY_PROTECTED_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
 		{
-			return i;
+			continue;
+		}
+
+		VkDeviceSize HeapSize = vkMemoryProperties.memoryHeaps[vkMemoryProperties.memoryTypes[i].heapIndex].size;
+
+		uint64_t Score =
+			((uint64_t) __builtin_popcount(Flags & Preferred) << 56) |
+			((uint64_t) (32 - __builtin_popcount(Extra)) << 48) |
+			MIN(HeapSize >> 20, (UINT64_C(1) << 48) - 1);
+
+		if(Best == UINT32_MAX || Score > BestScore)
+		{
+			Best = i;
+			BestScore = Score;
 		}
 	}
 
-	__builtin_unreachable();
+	return Best;
 }
 
 
-static void
-VulkanGetBuffer(
+static uint32_t
+VulkanGetMemory(
+	uint32_t Bits,
+	VkMemoryPropertyFlags Properties
+	)
+{
+	uint32_t Memory = VulkanFindMemory(Bits, Properties, 0);
+	AssertNEQ(Memory, UINT32_MAX);
+
+	return Memory;
+}
+
+
+/*
+ * Returns the property flags of the memory type it ended up in, which has
+ * every Required flag and as many Preferred ones as the buffer allows. The
+ * types with Preferred flags can sit in a small heap, like the 256 MB BAR
+ * of a discrete GPU, so when that heap is full the buffer goes to the type
+ * picked by Required alone and callers see it in the returned flags.
+ */
+static VkMemoryPropertyFlags
+VulkanGetPreferredBuffer(
 	VkDeviceSize Size,
 	VkBufferUsageFlags Usage,
-	VkMemoryPropertyFlags Properties,
+	VkMemoryPropertyFlags Required,
+	VkMemoryPropertyFlags Preferred,
 	VkBuffer* Buffer,
 	VkDeviceMemory* BufferMemory
 	)
@@ -1083,12 +2156,41 @@ VulkanGetBuffer(
 	AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 	AllocInfo.pNext = NULL;
 	AllocInfo.allocationSize = Requirements.size;
-	AllocInfo.memoryTypeIndex = VulkanGetMemory(Requirements.memoryTypeBits, Properties);
+	AllocInfo.memoryTypeIndex = VulkanFindMemory(Requirements.memoryTypeBits, Required, Preferred);
+
+	AssertNEQ(AllocInfo.memoryTypeIndex, UINT32_MAX);
 
 	Result = vkAllocateMemory(vkDevice, &AllocInfo, NULL, BufferMemory);
+
+	if(Result == VK_ERROR_OUT_OF_DEVICE_MEMORY && Preferred != 0)
+	{
+		uint32_t Fallback = VulkanFindMemory(Requirements.memoryTypeBits, Required, 0);
+
+		if(Fallback != AllocInfo.memoryTypeIndex)
+		{
+			AllocInfo.memoryTypeIndex = Fallback;
+			Result = vkAllocateMemory(vkDevice, &AllocInfo, NULL, BufferMemory);
+		}
+	}
+
 	AssertEQ(Result, VK_SUCCESS);
 
 	vkBindBufferMemory(vkDevice, *Buffer, *BufferMemory, 0);
+
+	return vkMemoryProperties.memoryTypes[AllocInfo.memoryTypeIndex].propertyFlags;
+}
+
+
+static void
+VulkanGetBuffer(
+	VkDeviceSize Size,
+	VkBufferUsageFlags Usage,
+	VkMemoryPropertyFlags Properties,
+	VkBuffer* Buffer,
+	VkDeviceMemory* BufferMemory
+	)
+{
+	VulkanGetPreferredBuffer(Size, Usage, Properties, 0, Buffer, BufferMemory);
 }
 
 
@@ -1111,8 +2213,8 @@ VulkanGetFinalBuffer(
 	VkDeviceMemory* BufferMemory
 	)
 {
-	VulkanGetBuffer(Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Buffer, BufferMemory);
+	VulkanGetBuffer(Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Buffer, BufferMemory);
 }
 
 
@@ -1121,11 +2223,20 @@ VulkanBeginCommandBuffer(
 	void
 	)
 {
-	VkResult Result = vkWaitForFences(vkDevice, 1, &vkFence, VK_TRUE, UINT64_MAX);
-	AssertEQ(Result, VK_SUCCESS);
+	VkResult Result;
 
-	Result = vkResetFences(vkDevice, 1, &vkFence);
-	AssertEQ(Result, VK_SUCCESS);
+	if(vkTimeline)
+	{
+		VulkanWaitTimeline(vkTransferSemaphore, vkTransferValue);
+	}
+	else
+	{
+		Result = vkWaitForFences(vkDevice, 1, &vkFence, VK_TRUE, UINT64_MAX);
+		AssertEQ(Result, VK_SUCCESS);
+
+		Result = vkResetFences(vkDevice, 1, &vkFence);
+		AssertEQ(Result, VK_SUCCESS);
+	}
 
 	Result = vkResetCommandBuffer(vkCommandBuffer, 0);
 	AssertEQ(Result, VK_SUCCESS);
@@ -1149,402 +2260,1382 @@ VulkanEndCommandBuffer(
 	VkResult Result = vkEndCommandBuffer(vkCommandBuffer);
 	AssertEQ(Result, VK_SUCCESS);
 
+	/*
+	 * Uploads on their own queue chain through one semaphore, the next
+	 * frame waits for it once no matter how many went in between. A
+	 * timeline needs no chain, it just moves on to the next value.
+	 */
+	int Handoff = vkTransferQueueID != vkQueueID;
+	VkPipelineStageFlags WaitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	uint64_t SignalValue = vkTransferValue + 1;
+
+	VkTimelineSemaphoreSubmitInfo TimelineInfo = {0};
+	TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	TimelineInfo.pNext = NULL;
+	TimelineInfo.waitSemaphoreValueCount = 0;
+	TimelineInfo.pWaitSemaphoreValues = NULL;
+	TimelineInfo.signalSemaphoreValueCount = 1;
+	TimelineInfo.pSignalSemaphoreValues = &SignalValue;
+
 	VkSubmitInfo SubmitInfo = {0};
 	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	SubmitInfo.pNext = NULL;
-	SubmitInfo.waitSemaphoreCount = 0;
-	SubmitInfo.pWaitSemaphores = NULL;
-	SubmitInfo.pWaitDstStageMask = NULL;
+	SubmitInfo.pNext = vkTimeline ? &TimelineInfo : NULL;
+	SubmitInfo.waitSemaphoreCount = !vkTimeline && Handoff && vkTransferPending;
+	SubmitInfo.pWaitSemaphores = &vkTransferSemaphore;
+	SubmitInfo.pWaitDstStageMask = &WaitStage;
 	SubmitInfo.commandBufferCount = 1;
 	SubmitInfo.pCommandBuffers = &vkCommandBuffer;
-	SubmitInfo.signalSemaphoreCount = 0;
-	SubmitInfo.pSignalSemaphores = NULL;
+	SubmitInfo.signalSemaphoreCount = vkTimeline || Handoff;
+	SubmitInfo.pSignalSemaphores = &vkTransferSemaphore;
 
-	vkQueueSubmit(vkQueue, 1, &SubmitInfo, vkFence);
-}
+	Result = vkQueueSubmit(vkTransferQueue, 1, &SubmitInfo, vkTimeline ? VK_NULL_HANDLE : vkFence);
+	AssertEQ(Result, VK_SUCCESS);
 
+	vkTransferValue = SignalValue;
 
-static void
-VulkanDestroyCopyBuffer(
-	void
-	)
-{
-	vkFreeMemory(vkDevice, vkCopyBufferMemory, NULL);
-	vkDestroyBuffer(vkDevice, vkCopyBuffer, NULL);
+	vkTransferPending |= Handoff;
 }
 
 
+/*
+ * Hands a resource the upload queue just wrote over to the graphics queue.
+ * The release half goes into the upload, the acquire half is recorded by
+ * the next frame.
+ */
 static void
-VulkanCopyToBuffer(
-	VkBuffer Buffer,
-	const void* Data,
-	VkDeviceSize Size
+VulkanReleaseImage(
+	VkImageMemoryBarrier* Barrier
 	)
 {
-	VulkanBeginCommandBuffer();
+	Barrier->dstAccessMask = 0;
+	Barrier->srcQueueFamilyIndex = vkTransferQueueID;
+	Barrier->dstQueueFamilyIndex = vkQueueID;
 
-	VulkanDestroyCopyBuffer();
+	vkCmdPipelineBarrier(vkCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, Barrier);
 
-	VulkanGetStagingBuffer(Size, &vkCopyBuffer, &vkCopyBufferMemory);
+	vkImageAcquires = GrowArray(vkImageAcquires, &vkImageAcquireSize, vkImageAcquireCount, sizeof(*vkImageAcquires));
 
-	void* Memory;
+	Barrier->srcAccessMask = 0;
+	Barrier->dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-	VkResult Result = vkMapMemory(vkDevice, vkCopyBufferMemory, 0, VK_WHOLE_SIZE, 0, &Memory);
-	AssertEQ(Result, VK_SUCCESS);
+	vkImageAcquires[vkImageAcquireCount++] = *Barrier;
+}
 
-	memcpy(Memory, Data, Size);
-	vkUnmapMemory(vkDevice, vkCopyBufferMemory);
 
-	VkBufferCopy Copy = {0};
-	Copy.srcOffset = 0;
-	Copy.dstOffset = 0;
-	Copy.size = Size;
+static void
+VulkanReleaseBuffer(
+	VkBuffer Buffer
+	)
+{
+	VkBufferMemoryBarrier Barrier = {0};
+	Barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	Barrier.pNext = NULL;
+	Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	Barrier.dstAccessMask = 0;
+	Barrier.srcQueueFamilyIndex = vkTransferQueueID;
+	Barrier.dstQueueFamilyIndex = vkQueueID;
+	Barrier.buffer = Buffer;
+	Barrier.offset = 0;
+	Barrier.size = VK_WHOLE_SIZE;
 
-	vkCmdCopyBuffer(vkCommandBuffer, vkCopyBuffer, Buffer, 1, &Copy);
+	vkCmdPipelineBarrier(vkCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 1, &Barrier, 0, NULL);
 
-	VulkanEndCommandBuffer();
+	vkBufferAcquires = GrowArray(vkBufferAcquires, &vkBufferAcquireSize, vkBufferAcquireCount,
+		sizeof(*vkBufferAcquires));
+
+	Barrier.srcAccessMask = 0;
+	Barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+	vkBufferAcquires[vkBufferAcquireCount++] = Barrier;
 }
 
 
 static void
-VulkanCopyToImage(
-	Image* Image,
-	const void* Data,
-	uint32_t TextureWidth,
-	uint32_t TextureHeight,
-	uint32_t TextureColumns,
-	uint32_t TextureRows
+VulkanRecordAcquires(
+	void
 	)
 {
-	VulkanBeginCommandBuffer();
+	if(vkImageAcquireCount == 0 && vkBufferAcquireCount == 0)
+	{
+		return;
+	}
 
-	VulkanDestroyCopyBuffer();
+	vkCmdPipelineBarrier(vkFrame->CommandBuffer, vkAcquireStages, vkAcquireStages, 0, 0, NULL,
+		vkBufferAcquireCount, vkBufferAcquires, vkImageAcquireCount, vkImageAcquires);
 
-	VkDeviceSize Pass = TextureWidth * 4;
-	VkDeviceSize BigPass = Pass * 7;
-	VkDeviceSize Size = Pass * TextureHeight * TextureColumns * TextureRows;
+	vkBufferAcquireCount = 0;
+	vkImageAcquireCount = 0;
+}
 
-	VulkanGetStagingBuffer(Size, &vkCopyBuffer, &vkCopyBufferMemory);
 
-	void* Memory;
+typedef enum RetireType
+{
+	RETIRE_PIPELINE,
+	RETIRE_IMAGE,
+	RETIRE_RENDER_PASS,
+	RETIRE_FRAMEBUFFERS,
+	RETIRE_BUFFER,
+	RETIRE_HOST,
+	kRETIRE
+}
+RetireType;
 
-	VkResult Result = vkMapMemory(vkDevice, vkCopyBufferMemory, 0, VK_WHOLE_SIZE, 0, &Memory);
-	AssertEQ(Result, VK_SUCCESS);
-
-	memcpy(Memory, Data, Size);
-	vkUnmapMemory(vkDevice, vkCopyBufferMemory);
-
-	uint32_t ImageWidth = TextureWidth * TextureColumns;
-	uint32_t ImageHeight = TextureHeight * TextureRows;
-
-	VkBufferImageCopy Copies[Image->Layers];
-
-	uint32_t i = 0;
-	VkBufferImageCopy* Copy = Copies;
-	VkDeviceSize BufferOffset = 0;
+typedef struct Retired
+{
+	RetireType Type;
+	uint64_t Frame;
+	uint64_t Upload;
 
-	while(1)
+	union
 	{
-		*Copy = (VkBufferImageCopy){0};
-		Copy->bufferOffset = BufferOffset;
-		Copy->bufferRowLength = ImageWidth;
-		Copy->bufferImageHeight = ImageHeight;
-		Copy->imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		Copy->imageSubresource.mipLevel = 0;
-		Copy->imageSubresource.baseArrayLayer = i;
-		Copy->imageSubresource.layerCount = 1;
-		Copy->imageOffset.x = 0;
-		Copy->imageOffset.y = 0;
-		Copy->imageOffset.z = 0;
-		Copy->imageExtent.width = TextureWidth;
-		Copy->imageExtent.height = TextureHeight;
-		Copy->imageExtent.depth = 1;
-
-		if(++i == Image->Layers)
-		{
-			break;
-		}
-
-		if(i % TextureColumns == 0)
-		{
-			BufferOffset += BigPass;
-		}
-		else
+		VkPipeline Pipeline;
+		Image Image;
+		VkRenderPass RenderPass;
+		VkFramebuffer* Framebuffers;
+		struct
 		{
-			BufferOffset += Pass;
-		}
-
-		++Copy;
-	}
+			VkBuffer Buffer;
+			VkDeviceMemory Memory;
+		};
+		void* Host;
+	};
+}
+Retired;
 
-	vkCmdCopyBufferToImage(vkCommandBuffer, vkCopyBuffer, Image->Image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ARRAYLEN(Copies), Copies);
+static Retired* vkRetired;
+static uint32_t vkRetiredCount;
+static uint32_t vkRetiredSize;
 
-	VulkanEndCommandBuffer();
-}
+static uint64_t vkFrameCount;
 
 
+/*
+ * Objects that might still be used by work in flight are tagged with the
+ * next frame value and the last upload value, and destroyed once both have
+ * completed.
+ */
 static void
-VulkanCreateImageGeneric(
-	uint32_t Width,
-	uint32_t Height,
-	VkFormat Format,
-	uint32_t Layers,
-	VkImageAspectFlags Aspect,
-	VkSampleCountFlagBits Samples,
-	VkImageUsageFlags Usage,
-	VkMemoryPropertyFlags Properties,
-	Image* Image
+VulkanRetire(
+	Retired Object
 	)
 {
-	VkImageCreateInfo ImageInfo = {0};
-	ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	ImageInfo.pNext = NULL;
-	ImageInfo.flags = 0;
-	ImageInfo.imageType = VK_IMAGE_TYPE_2D;
-	ImageInfo.format = Format;
-	ImageInfo.extent.width = Width;
-	ImageInfo.extent.height = Height;
-	ImageInfo.extent.depth = 1;
-	ImageInfo.mipLevels = 1;
-	ImageInfo.arrayLayers = Layers;
-	ImageInfo.samples = Samples;
-	ImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	ImageInfo.usage = Usage;
-	ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	ImageInfo.queueFamilyIndexCount = 0;
-	ImageInfo.pQueueFamilyIndices = NULL;
-	ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	vkRetired = GrowArray(vkRetired, &vkRetiredSize, vkRetiredCount, sizeof(*vkRetired));
 
-	VkResult Result = vkCreateImage(vkDevice, &ImageInfo, NULL, &Image->Image);
-	AssertEQ(Result, VK_SUCCESS);
+	Object.Frame = vkFrameValue + 1;
+	Object.Upload = vkTransferValue;
+	vkRetired[vkRetiredCount++] = Object;
 
-	VkMemoryRequirements Requirements;
-	vkGetImageMemoryRequirements(vkDevice, Image->Image, &Requirements);
+	++vkRecordGeneration;
+}
 
-	VkMemoryAllocateInfo AllocInfo = {0};
-	AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	AllocInfo.pNext = NULL;
-	AllocInfo.allocationSize = Requirements.size;
-	AllocInfo.memoryTypeIndex = VulkanGetMemory(Requirements.memoryTypeBits, Properties);
 
-	Result = vkAllocateMemory(vkDevice, &AllocInfo, NULL, &Image->Memory);
-	AssertEQ(Result, VK_SUCCESS);
+static void
+VulkanRetireBuffer(
+	VkBuffer Buffer,
+	VkDeviceMemory Memory
+	)
+{
+	VulkanRetire((Retired){ .Type = RETIRE_BUFFER, .Buffer = Buffer, .Memory = Memory });
+}
 
-	Result = vkBindImageMemory(vkDevice, Image->Image, Image->Memory, 0);
-	AssertEQ(Result, VK_SUCCESS);
 
-	VkImageViewCreateInfo ViewInfo = {0};
-	ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	ViewInfo.pNext = NULL;
-	ViewInfo.flags = 0;
-	ViewInfo.image = Image->Image;
-	ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
-	ViewInfo.format = Format;
-	ViewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-	ViewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-	ViewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-	ViewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-	ViewInfo.subresourceRange.aspectMask = Aspect;
-	ViewInfo.subresourceRange.baseMipLevel = 0;
-	ViewInfo.subresourceRange.levelCount = 1;
-	ViewInfo.subresourceRange.baseArrayLayer = 0;
-	ViewInfo.subresourceRange.layerCount = Layers;
+/*
+ * The staging buffer of an upload goes once that upload is done instead of
+ * being held until the next one has waited for it.
+ */
+static void
+VulkanRetireCopyBuffer(
+	void
+	)
+{
+	VulkanRetireBuffer(vkCopyBuffer, vkCopyBufferMemory);
 
-	Result = vkCreateImageView(vkDevice, &ViewInfo, NULL, &Image->View);
-	AssertEQ(Result, VK_SUCCESS);
+	/* Only the upload queue ever touched it, no frame has to finish first */
+	vkRetired[vkRetiredCount - 1].Frame = 0;
 
-	Image->Layers = Layers;
+	vkCopyBuffer = VK_NULL_HANDLE;
+	vkCopyBufferMemory = VK_NULL_HANDLE;
 }
 
 
-static void
-VulkanCreateTextureImage(
-	uint32_t TextureWidth,
-	uint32_t TextureHeight,
-	uint32_t Layers,
-	Image* Image
-	)
+/*
+ * Host allocations that uploads may read in place. They start on the import
+ * alignment and are padded to a multiple of it, and freeing them waits for
+ * the uploads that might still be reading.
+ */
+typedef struct HostAllocation
 {
-	VulkanCreateImageGeneric(TextureHeight, TextureHeight, VK_FORMAT_B8G8R8A8_SRGB, Layers,
-		VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-		VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Image);
+	void* Data;
+	VkDeviceSize Size;
 }
+HostAllocation;
 
+static HostAllocation* vkHostAllocations;
+static uint32_t vkHostAllocationCount;
+static uint32_t vkHostAllocationSize;
 
-static void
-VulkanCreateDepthImage(
-	Image* Image
+
+static void*
+VulkanAllocHost(
+	VkDeviceSize Size
 	)
 {
-	VulkanCreateImageGeneric(vkExtent.width, vkExtent.height, VK_FORMAT_D32_SFLOAT, 1,
-		VK_IMAGE_ASPECT_DEPTH_BIT, vkSamples, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Image);
+	VkDeviceSize Alignment = MAX(vkHostAlignment, 64);
+	VkDeviceSize Padded = (Size + Alignment - 1) / Alignment * Alignment;
+
+#ifdef _WIN32
+	void* Data = _aligned_malloc(Padded, Alignment);
+#else
+	void* Data = aligned_alloc(Alignment, Padded);
+#endif
+	AssertNEQ(Data, NULL);
+
+	vkHostAllocations = GrowArray(vkHostAllocations, &vkHostAllocationSize,
+		vkHostAllocationCount, sizeof(*vkHostAllocations));
+	vkHostAllocations[vkHostAllocationCount++] = (HostAllocation){ .Data = Data, .Size = Padded };
+
+	return Data;
 }
 
 
 static void
-VulkanCreateMultisampledImage(
-	Image* Image
+VulkanFreeHostNow(
+	void* Data
 	)
 {
-	VulkanCreateImageGeneric(vkExtent.width, vkExtent.height, VK_FORMAT_B8G8R8A8_SRGB, 1,
-		VK_IMAGE_ASPECT_COLOR_BIT, vkSamples, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Image);
+#ifdef _WIN32
+	_aligned_free(Data);
+#else
+	free(Data);
+#endif
 }
 
 
 static void
-VulkanDestroyImage(
-	Image* Image
+VulkanFreeHost(
+	void* Data
 	)
 {
-	vkFreeMemory(vkDevice, Image->Memory, NULL);
-	vkDestroyImageView(vkDevice, Image->View, NULL);
-	vkDestroyImage(vkDevice, Image->Image, NULL);
+	for(uint32_t i = 0; i < vkHostAllocationCount; ++i)
+	{
+		if(vkHostAllocations[i].Data == Data)
+		{
+			vkHostAllocations[i] = vkHostAllocations[--vkHostAllocationCount];
+			break;
+		}
+	}
+
+	VulkanRetire((Retired){ .Type = RETIRE_HOST, .Host = Data });
+
+	/* Only uploads read host memory */
+	vkRetired[vkRetiredCount - 1].Frame = 0;
 }
 
 
-static void
-VulkanTransitionImageLayout(
-	Image* Image,
-	VkImageLayout From,
-	VkImageLayout To
+/*
+ * Wraps Data in a transfer source buffer without copying it. Memory from
+ * VulkanAllocHost always qualifies, its padding is ours and VulkanFreeHost
+ * waits for the upload. Anything else qualifies when the caller says it is
+ * Kept, alive and unchanged until the uploads have completed, and both Data
+ * and Size are multiples of minImportedHostPointerAlignment, like mmap'd
+ * files or arena blocks. Returns -1 when the caller has to stage the data.
+ */
+static int
+VulkanImportHostBuffer(
+	const void* Data,
+	VkDeviceSize Size,
+	int Kept,
+	VkBuffer* Buffer,
+	VkDeviceMemory* BufferMemory
 	)
 {
-	VulkanBeginCommandBuffer();
-
-	VkPipelineStageFlags SourceStage;
-	VkPipelineStageFlags DestinationStage;
+	if(vkHostAlignment == 0 || (uintptr_t) Data % vkHostAlignment != 0)
+	{
+		return -1;
+	}
 
-	VkImageMemoryBarrier Barrier = {0};
-	Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	Barrier.pNext = NULL;
-	Barrier.srcAccessMask = 0;
-	Barrier.dstAccessMask = 0;
+	VkDeviceSize Padded = (Size + vkHostAlignment - 1) / vkHostAlignment * vkHostAlignment;
+	int Owned = Kept && Padded == Size;
 
-	if(From == VK_IMAGE_LAYOUT_UNDEFINED && To == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+	for(uint32_t i = 0; !Owned && i < vkHostAllocationCount; ++i)
 	{
-		Barrier.srcAccessMask = 0;
-		Barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		const uint8_t* Start = vkHostAllocations[i].Data;
 
-		SourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		DestinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		if((const uint8_t*) Data >= Start && (const uint8_t*) Data + Padded <= Start + vkHostAllocations[i].Size)
+		{
+			Owned = 1;
+			break;
+		}
 	}
-	else if(From == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && To == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-	{
-		Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		Barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-		SourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		DestinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else
+	if(!Owned)
 	{
-		AssertEQ(0, 1);
+		return -1;
 	}
 
-	Barrier.oldLayout = From;
-	Barrier.newLayout = To;
-	Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	Barrier.image = Image->Image;
-	Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	Barrier.subresourceRange.baseMipLevel = 0;
-	Barrier.subresourceRange.levelCount = 1;
-	Barrier.subresourceRange.baseArrayLayer = 0;
-	Barrier.subresourceRange.layerCount = Image->Layers;
+	VkMemoryHostPointerPropertiesEXT Properties = {0};
+	Properties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+	Properties.pNext = NULL;
 
-	vkCmdPipelineBarrier(vkCommandBuffer, SourceStage, DestinationStage, 0, 0, NULL, 0, NULL, 1, &Barrier);
+	VkResult Result = vkGetMemoryHostPointerProperties(vkDevice,
+		VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, Data, &Properties);
 
-	VulkanEndCommandBuffer();
-}
+	if(Result != VK_SUCCESS)
+	{
+		return -1;
+	}
 
+	VkExternalMemoryBufferCreateInfo External = {0};
+	External.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+	External.pNext = NULL;
+	External.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
 
-static void
-VulkanCreateTexture(
-	const char* Path,
-	Image* Image
-	)
-{
-	int ImageWidth;
-	int ImageHeight;
-	int ImageChannels;
+	VkBufferCreateInfo CreateInfo = {0};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	CreateInfo.pNext = &External;
+	CreateInfo.flags = 0;
+	CreateInfo.size = Padded;
+	CreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	CreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	CreateInfo.queueFamilyIndexCount = 0;
+	CreateInfo.pQueueFamilyIndices = NULL;
 
-	stbi_uc* Pixels = stbi_load(Path, &ImageWidth, &ImageHeight, &ImageChannels, STBI_rgb_alpha);
-	AssertNEQ(Pixels, NULL);
+	Result = vkCreateBuffer(vkDevice, &CreateInfo, NULL, Buffer);
+	AssertEQ(Result, VK_SUCCESS);
 
-	uint32_t TextureWidth;
-	uint32_t TextureHeight;
-	uint32_t TextureLayers;
+	VkMemoryRequirements Requirements;
+	vkGetBufferMemoryRequirements(vkDevice, *Buffer, &Requirements);
 
-	const char* File = Path + strlen(Path);
+	uint32_t Type = VulkanFindMemory(Requirements.memoryTypeBits & Properties.memoryTypeBits, 0, 0);
 
-	while(File != Path && *(File - 1) != '/')
+	if(Type == UINT32_MAX || Requirements.size > Padded)
 	{
-		--File;
+		vkDestroyBuffer(vkDevice, *Buffer, NULL);
+		return -1;
 	}
 
-	int Parsed = sscanf(File, "%ux%ux%u", &TextureWidth, &TextureHeight, &TextureLayers);
-	AssertEQ(Parsed, 3);
-	AssertEQ(ImageWidth % TextureWidth, 0);
-	AssertEQ(ImageHeight % TextureHeight, 0);
+	VkImportMemoryHostPointerInfoEXT Import = {0};
+	Import.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+	Import.pNext = NULL;
+	Import.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+	Import.pHostPointer = (void*) Data;
 
-	VulkanCreateTextureImage(TextureWidth, TextureHeight, TextureLayers, Image);
+	VkMemoryAllocateInfo AllocInfo = {0};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	AllocInfo.pNext = &Import;
+	AllocInfo.allocationSize = Padded;
+	AllocInfo.memoryTypeIndex = Type;
 
-	VulkanTransitionImageLayout(Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	Result = vkAllocateMemory(vkDevice, &AllocInfo, NULL, BufferMemory);
 
-	VulkanCopyToImage(Image, Pixels, TextureWidth, TextureHeight,
-		ImageWidth / TextureWidth, ImageHeight / TextureHeight);
+	if(Result != VK_SUCCESS)
+	{
+		vkDestroyBuffer(vkDevice, *Buffer, NULL);
+		return -1;
+	}
 
-	stbi_image_free(Pixels);
+	vkBindBufferMemory(vkDevice, *Buffer, *BufferMemory, 0);
 
-	VulkanTransitionImageLayout(Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	return 0;
 }
 
 
 static void
-VulkanDestroyTexture(
-	Image* Texture
+VulkanDestroyCopyBuffer(
+	void
 	)
 {
-	VulkanDestroyImage(Texture);
+	vkFreeMemory(vkDevice, vkCopyBufferMemory, NULL);
+	vkDestroyBuffer(vkDevice, vkCopyBuffer, NULL);
+
+	free(vkHostAllocations);
 }
 
 
 static void
-VulkanInitDepthBuffer(
-	void
+VulkanCopyToBuffer(
+	VkBuffer Buffer,
+	const void* Data,
+	VkDeviceSize Size,
+	int Kept
 	)
 {
-	VulkanCreateDepthImage(&vkDepthBuffer);
-}
+	VulkanBeginCommandBuffer();
 
+	if(VulkanImportHostBuffer(Data, Size, Kept, &vkCopyBuffer, &vkCopyBufferMemory) != 0)
+	{
+		VulkanGetStagingBuffer(Size, &vkCopyBuffer, &vkCopyBufferMemory);
 
-static void
-VulkanDestroyDepthBuffer(
-	void
-	)
-{
-	VulkanDestroyImage(&vkDepthBuffer);
-}
+		void* Memory;
 
+		VkResult Result = vkMapMemory(vkDevice, vkCopyBufferMemory, 0, VK_WHOLE_SIZE, 0, &Memory);
+		AssertEQ(Result, VK_SUCCESS);
 
-static void
-VulkanInitMultisampling(
-	void
-	)
-{
-	VulkanCreateMultisampledImage(&vkMultisampling);
-}
+		memcpy(Memory, Data, Size);
+		vkUnmapMemory(vkDevice, vkCopyBufferMemory);
+	}
 
+	VkBufferCopy Copy = {0};
+	Copy.srcOffset = 0;
+	Copy.dstOffset = 0;
+	Copy.size = Size;
 
-static void
-VulkanDestroyMultisampling(
-	void
-	)
-{
-	VulkanDestroyImage(&vkMultisampling);
+	vkCmdCopyBuffer(vkCommandBuffer, vkCopyBuffer, Buffer, 1, &Copy);
+
+	if(vkTransferQueueID != vkQueueID)
+	{
+		VulkanReleaseBuffer(Buffer);
+	}
+
+	VulkanEndCommandBuffer();
+
+	VulkanRetireCopyBuffer();
+}
+
+
+/*
+ * Creates a device local buffer holding Data. When the memory it lands in is
+ * host visible too, as on integrated GPUs or with resizable BAR, Data is
+ * written in place and there is no staging buffer or copy at all. A full BAR
+ * heap leaves it in plain device memory, which takes the staging path.
+ */
+static void
+VulkanUploadFinalBuffer(
+	const void* Data,
+	VkDeviceSize Size,
+	int Kept,
+	VkBuffer* Buffer,
+	VkDeviceMemory* BufferMemory
+	)
+{
+	VkMemoryPropertyFlags Direct = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	VkMemoryPropertyFlags Flags = VulkanGetPreferredBuffer(Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Direct, Buffer, BufferMemory);
+
+	if((Flags & Direct) != Direct)
+	{
+		VulkanCopyToBuffer(*Buffer, Data, Size, Kept);
+		return;
+	}
+
+	void* Memory;
+
+	VkResult Result = vkMapMemory(vkDevice, *BufferMemory, 0, VK_WHOLE_SIZE, 0, &Memory);
+	AssertEQ(Result, VK_SUCCESS);
+
+	memcpy(Memory, Data, Size);
+	vkUnmapMemory(vkDevice, *BufferMemory);
+}
+
+
+static VkBufferImageCopy
+VulkanGetLayerCopy(
+	uint32_t Layer,
+	VkDeviceSize Offset,
+	uint32_t RowLength,
+	uint32_t Width,
+	uint32_t Height
+	)
+{
+	VkBufferImageCopy Copy = {0};
+	Copy.bufferOffset = Offset;
+	Copy.bufferRowLength = RowLength;
+	Copy.bufferImageHeight = Height;
+	Copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	Copy.imageSubresource.mipLevel = 0;
+	Copy.imageSubresource.baseArrayLayer = Layer;
+	Copy.imageSubresource.layerCount = 1;
+	Copy.imageOffset.x = 0;
+	Copy.imageOffset.y = 0;
+	Copy.imageOffset.z = 0;
+	Copy.imageExtent.width = Width;
+	Copy.imageExtent.height = Height;
+	Copy.imageExtent.depth = 1;
+
+	return Copy;
+}
+
+
+/*
+ * Uploads one row of tiles at a time through a staging buffer that is only
+ * as big as that row, so there never is a second full size copy of the image.
+ * Data that can be imported is copied from in place, all rows at once, see
+ * VulkanImportHostBuffer for what Kept promises.
+ */
+static void
+VulkanCopyToImage(
+	Image* Image,
+	const void* Data,
+	uint32_t TexelSize,
+	uint32_t TextureWidth,
+	uint32_t TextureHeight,
+	uint32_t TextureColumns,
+	uint32_t TextureRows,
+	int Kept
+	)
+{
+	VulkanBeginCommandBuffer();
+
+	VkDeviceSize Pass = TextureWidth * TexelSize;
+	VkDeviceSize BigPass = Pass * TextureColumns * TextureHeight;
+
+	uint32_t ImageWidth = TextureWidth * TextureColumns;
+
+	if(VulkanImportHostBuffer(Data, BigPass * TextureRows, Kept, &vkCopyBuffer, &vkCopyBufferMemory) == 0)
+	{
+		VkBufferImageCopy Copies[Image->Layers];
+
+		for(uint32_t i = 0; i < Image->Layers; ++i)
+		{
+			Copies[i] = VulkanGetLayerCopy(i, (i / TextureColumns) * BigPass + (i % TextureColumns) * Pass,
+				ImageWidth, TextureWidth, TextureHeight);
+		}
+
+		vkCmdCopyBufferToImage(vkCommandBuffer, vkCopyBuffer, Image->Image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ARRAYLEN(Copies), Copies);
+
+		VulkanEndCommandBuffer();
+		VulkanRetireCopyBuffer();
+
+		return;
+	}
+
+	VulkanGetStagingBuffer(BigPass, &vkCopyBuffer, &vkCopyBufferMemory);
+
+	void* Memory;
+
+	VkResult Result = vkMapMemory(vkDevice, vkCopyBufferMemory, 0, VK_WHOLE_SIZE, 0, &Memory);
+	AssertEQ(Result, VK_SUCCESS);
+
+	const uint8_t* Row = Data;
+	const uint8_t* RowEnd = Row + BigPass * TextureRows;
+
+	uint32_t i = 0;
+
+	while(1)
+	{
+		memcpy(Memory, Row, BigPass);
+
+		VkBufferImageCopy Copies[TextureColumns];
+		VkBufferImageCopy* Copy = Copies;
+
+		do
+		{
+			*(Copy++) = VulkanGetLayerCopy(i, (i % TextureColumns) * Pass, ImageWidth, TextureWidth, TextureHeight);
+		}
+		while(++i != Image->Layers && i % TextureColumns != 0);
+
+		vkCmdCopyBufferToImage(vkCommandBuffer, vkCopyBuffer, Image->Image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, Copy - Copies, Copies);
+
+		VulkanEndCommandBuffer();
+
+		Row += BigPass;
+
+		if(i == Image->Layers || Row == RowEnd)
+		{
+			break;
+		}
+
+		VulkanBeginCommandBuffer();
+	}
+
+	vkUnmapMemory(vkDevice, vkCopyBufferMemory);
+
+	VulkanRetireCopyBuffer();
+}
+
+
+static void
+VulkanCreateImageHandle(
+	uint32_t Width,
+	uint32_t Height,
+	VkFormat Format,
+	uint32_t Layers,
+	VkSampleCountFlagBits Samples,
+	VkImageUsageFlags Usage,
+	Image* Image
+	)
+{
+	VkImageCreateInfo ImageInfo = {0};
+	ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	ImageInfo.pNext = NULL;
+	ImageInfo.flags = 0;
+	ImageInfo.imageType = VK_IMAGE_TYPE_2D;
+	ImageInfo.format = Format;
+	ImageInfo.extent.width = Width;
+	ImageInfo.extent.height = Height;
+	ImageInfo.extent.depth = 1;
+	ImageInfo.mipLevels = 1;
+	ImageInfo.arrayLayers = Layers;
+	ImageInfo.samples = Samples;
+	ImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	ImageInfo.usage = Usage;
+	ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	ImageInfo.queueFamilyIndexCount = 0;
+	ImageInfo.pQueueFamilyIndices = NULL;
+	ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkResult Result = vkCreateImage(vkDevice, &ImageInfo, NULL, &Image->Image);
+	AssertEQ(Result, VK_SUCCESS);
+
+	Image->Layers = Layers;
+	Image->Memory = VK_NULL_HANDLE;
+}
+
+
+static void
+VulkanCreateImageView(
+	VkFormat Format,
+	VkImageAspectFlags Aspect,
+	Image* Image
+	)
+{
+	VkImageViewCreateInfo ViewInfo = {0};
+	ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	ViewInfo.pNext = NULL;
+	ViewInfo.flags = 0;
+	ViewInfo.image = Image->Image;
+	ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	ViewInfo.format = Format;
+	ViewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+	ViewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+	ViewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+	ViewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+	ViewInfo.subresourceRange.aspectMask = Aspect;
+	ViewInfo.subresourceRange.baseMipLevel = 0;
+	ViewInfo.subresourceRange.levelCount = 1;
+	ViewInfo.subresourceRange.baseArrayLayer = 0;
+	ViewInfo.subresourceRange.layerCount = Image->Layers;
+
+	VkResult Result = vkCreateImageView(vkDevice, &ViewInfo, NULL, &Image->View);
+	AssertEQ(Result, VK_SUCCESS);
+}
+
+
+static void
+VulkanCreateImageGeneric(
+	uint32_t Width,
+	uint32_t Height,
+	VkFormat Format,
+	uint32_t Layers,
+	VkImageAspectFlags Aspect,
+	VkSampleCountFlagBits Samples,
+	VkImageUsageFlags Usage,
+	VkMemoryPropertyFlags Properties,
+	Image* Image
+	)
+{
+	VulkanCreateImageHandle(Width, Height, Format, Layers, Samples, Usage, Image);
+
+	VkMemoryRequirements Requirements;
+	vkGetImageMemoryRequirements(vkDevice, Image->Image, &Requirements);
+
+	VkMemoryAllocateInfo AllocInfo = {0};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	AllocInfo.pNext = NULL;
+	AllocInfo.allocationSize = Requirements.size;
+	AllocInfo.memoryTypeIndex = VulkanGetMemory(Requirements.memoryTypeBits, Properties);
+
+	VkResult Result = vkAllocateMemory(vkDevice, &AllocInfo, NULL, &Image->Memory);
+	AssertEQ(Result, VK_SUCCESS);
+
+	Result = vkBindImageMemory(vkDevice, Image->Image, Image->Memory, 0);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VulkanCreateImageView(Format, Aspect, Image);
+}
+
+
+static void
+VulkanCreateTextureImage(
+	uint32_t TextureWidth,
+	uint32_t TextureHeight,
+	VkFormat Format,
+	uint32_t Layers,
+	Image* Image
+	)
+{
+	VulkanCreateImageGeneric(TextureWidth, TextureHeight, Format, Layers,
+		VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+		VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Image);
+}
+
+
+static void
+VulkanCreateOffscreenImage(
+	Image* Image
+	)
+{
+	VulkanCreateImageGeneric(vkExtent.width, vkExtent.height, VK_FORMAT_B8G8R8A8_SRGB, 1,
+		VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Image);
+}
+
+
+static void
+VulkanDestroyImage(
+	Image* Image
+	)
+{
+	vkFreeMemory(vkDevice, Image->Memory, NULL);
+	vkDestroyImageView(vkDevice, Image->View, NULL);
+	vkDestroyImage(vkDevice, Image->Image, NULL);
+}
+
+
+static void
+VulkanTransitionImageLayout(
+	Image* Image,
+	VkImageLayout From,
+	VkImageLayout To
+	)
+{
+	VulkanBeginCommandBuffer();
+
+	VkPipelineStageFlags SourceStage;
+	VkPipelineStageFlags DestinationStage;
+
+	VkImageMemoryBarrier Barrier = {0};
+	Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	Barrier.pNext = NULL;
+	Barrier.srcAccessMask = 0;
+	Barrier.dstAccessMask = 0;
+
+	if(From == VK_IMAGE_LAYOUT_UNDEFINED && To == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+	{
+		Barrier.srcAccessMask = 0;
+		Barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		SourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		DestinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	else if(From == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && To == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	{
+		Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		Barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		SourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		DestinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	}
+	else
+	{
+		AssertEQ(0, 1);
+	}
+
+	Barrier.oldLayout = From;
+	Barrier.newLayout = To;
+	Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	Barrier.image = Image->Image;
+	Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	Barrier.subresourceRange.baseMipLevel = 0;
+	Barrier.subresourceRange.levelCount = 1;
+	Barrier.subresourceRange.baseArrayLayer = 0;
+	Barrier.subresourceRange.layerCount = Image->Layers;
+
+	if(To == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && vkTransferQueueID != vkQueueID)
+	{
+		VulkanReleaseImage(&Barrier);
+	}
+	else
+	{
+		vkCmdPipelineBarrier(vkCommandBuffer, SourceStage, DestinationStage, 0, 0, NULL, 0, NULL, 1, &Barrier);
+	}
+
+	VulkanEndCommandBuffer();
+}
+
+
+typedef struct Pixels
+{
+	stbi_uc* Data;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t TextureWidth;
+	uint32_t TextureHeight;
+	uint32_t TextureLayers;
+}
+Pixels;
+
+
+static int
+VulkanTryLoadPixels(
+	const char* Path,
+	Pixels* Pixels
+	)
+{
+	int ImageWidth;
+	int ImageHeight;
+	int ImageChannels;
+
+	const char* File = Path + strlen(Path);
+
+	while(File != Path && *(File - 1) != '/')
+	{
+		--File;
+	}
+
+	int Parsed = sscanf(File, "%ux%ux%u", &Pixels->TextureWidth, &Pixels->TextureHeight, &Pixels->TextureLayers);
+
+	if(Parsed != 3 || Pixels->TextureWidth == 0 || Pixels->TextureHeight == 0)
+	{
+		return -1;
+	}
+
+	Pixels->Data = stbi_load(Path, &ImageWidth, &ImageHeight, &ImageChannels, STBI_rgb_alpha);
+
+	if(Pixels->Data == NULL)
+	{
+		return -1;
+	}
+
+	Pixels->Width = ImageWidth;
+	Pixels->Height = ImageHeight;
+
+	if(Pixels->Width % Pixels->TextureWidth != 0 || Pixels->Height % Pixels->TextureHeight != 0)
+	{
+		stbi_image_free(Pixels->Data);
+		Pixels->Data = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static void
+VulkanLoadPixels(
+	const char* Path,
+	Pixels* Pixels
+	)
+{
+	int Error = VulkanTryLoadPixels(Path, Pixels);
+	AssertEQ(Error, 0);
+}
+
+
+static void
+VulkanFreePixels(
+	Pixels* Pixels
+	)
+{
+	stbi_image_free(Pixels->Data);
+	Pixels->Data = NULL;
+}
+
+
+static void
+VulkanCreateTexture(
+	const Pixels* Pixels,
+	Image* Image
+	)
+{
+	VulkanCreateTextureImage(Pixels->TextureWidth, Pixels->TextureHeight,
+		VK_FORMAT_R8G8B8A8_SRGB, Pixels->TextureLayers, Image);
+
+	VulkanTransitionImageLayout(Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	VulkanCopyToImage(Image, Pixels->Data, 4, Pixels->TextureWidth, Pixels->TextureHeight,
+		Pixels->Width / Pixels->TextureWidth, Pixels->Height / Pixels->TextureHeight, 0);
+
+	VulkanTransitionImageLayout(Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+
+/*
+ * Replaces every pixel with an index into a palette of at most 256 colors.
+ * All fully transparent pixels share a single palette entry. Returns the
+ * number of palette entries used.
+ */
+static uint32_t
+VulkanIndexPixels(
+	const uint32_t* Pixels,
+	uint64_t Count,
+	uint8_t* Indices,
+	uint32_t* Palette
+	)
+{
+	uint32_t Keys[512];
+	uint8_t Values[512];
+	uint8_t Used[512] = {0};
+
+	uint32_t Colors = 0;
+
+	for(uint64_t i = 0; i < Count; ++i)
+	{
+		uint32_t Color = Pixels[i];
+
+		if((Color >> 24) == 0)
+		{
+			Color = 0;
+		}
+
+		uint32_t Slot = (Color * 2654435761u) >> 23;
+
+		while(Used[Slot] && Keys[Slot] != Color)
+		{
+			Slot = (Slot + 1) % ARRAYLEN(Keys);
+		}
+
+		if(!Used[Slot])
+		{
+			AssertNEQ(Colors, 256);
+
+			Used[Slot] = 1;
+			Keys[Slot] = Color;
+			Values[Slot] = Colors;
+			Palette[Colors++] = Color;
+		}
+
+		Indices[i] = Values[Slot];
+	}
+
+	return Colors;
+}
+
+
+static void
+VulkanCreateIndexedTexture(
+	const Pixels* Pixels,
+	Image* Image,
+	uint32_t* Palette
+	)
+{
+	uint64_t Count = (uint64_t) Pixels->Width * Pixels->Height;
+
+	uint8_t* Indices = VulkanAllocHost(Count);
+
+	memset(Palette, 0, sizeof(uint32_t) * 256);
+	VulkanIndexPixels((const uint32_t*) Pixels->Data, Count, Indices, Palette);
+
+	VulkanCreateTextureImage(Pixels->TextureWidth, Pixels->TextureHeight,
+		VK_FORMAT_R8_UINT, Pixels->TextureLayers, Image);
+
+	VulkanTransitionImageLayout(Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	VulkanCopyToImage(Image, Indices, 1, Pixels->TextureWidth, Pixels->TextureHeight,
+		Pixels->Width / Pixels->TextureWidth, Pixels->Height / Pixels->TextureHeight, 1);
+
+	VulkanFreeHost(Indices);
+
+	VulkanTransitionImageLayout(Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+
+/*
+ * Every layer of the palette image is one 256 entry palette. Palette swaps
+ * are just more layers, the indexed texture itself is shared.
+ */
+static void
+VulkanCreatePalette(
+	const uint32_t* Palettes,
+	uint32_t Count,
+	Image* Image
+	)
+{
+	VulkanCreateTextureImage(256, 1, VK_FORMAT_R8G8B8A8_SRGB, Count, Image);
+
+	VulkanTransitionImageLayout(Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	VulkanCopyToImage(Image, Palettes, 4, 256, 1, 1, Count, 0);
+
+	VulkanTransitionImageLayout(Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+
+static void
+VulkanDestroyTexture(
+	Image* Texture
+	)
+{
+	VulkanDestroyImage(Texture);
+}
+
+
+/*
+ * Sheet 0 only goes up as indices and its palette, instances with Palette 0
+ * are drawn from palette layer 0 like those with Palette 1. Its slot in
+ * vkTextures stays empty.
+ */
+static void
+VulkanCreateTextures(
+	const Pixels* Pixels,
+	uint32_t Sheet
+	)
+{
+	if(Sheet != 0)
+	{
+		VulkanCreateTexture(Pixels, vkTextures + Sheet);
+		return;
+	}
+
+	uint32_t Palette[256];
+	VulkanCreateIndexedTexture(Pixels, &vkIndexedTexture, Palette);
+	VulkanCreatePalette(Palette, 1, &vkPalette);
+}
+
+
+static void
+VulkanCreateFontTexture(
+	void
+	)
+{
+	const char* Path = getenv("VULKAN_FONT");
+	vkFontLoaded = FontLoad(&vkFont, Path ? Path : vkFontPath, vkFontPixelHeight) == 0;
+
+	if(!vkFontLoaded)
+	{
+		printf("font %s could not be loaded, text is disabled\n", Path ? Path : vkFontPath);
+
+		uint8_t Empty = 0;
+
+		VulkanCreateTextureImage(1, 1, VK_FORMAT_R8_UNORM, 1, &vkFontTexture);
+		VulkanTransitionImageLayout(&vkFontTexture, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		VulkanCopyToImage(&vkFontTexture, &Empty, 1, 1, 1, 1, 1, 0);
+		VulkanTransitionImageLayout(&vkFontTexture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		return;
+	}
+
+	VulkanCreateTextureImage(vkFont.GlyphSize, vkFont.GlyphSize, VK_FORMAT_R8_UNORM,
+		FONT_GLYPH_COUNT, &vkFontTexture);
+
+	VulkanTransitionImageLayout(&vkFontTexture, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	VulkanCopyToImage(&vkFontTexture, vkFont.Pixels, 1, vkFont.GlyphSize, vkFont.GlyphSize, 1, FONT_GLYPH_COUNT, 0);
+
+	VulkanTransitionImageLayout(&vkFontTexture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	/* Only the metrics are needed from here on */
+	free(vkFont.Pixels);
+	vkFont.Pixels = NULL;
+}
+
+
+static void
+VulkanDestroyTextures(
+	void
+	)
+{
+	VulkanDestroyTexture(&vkFontTexture);
+	FontFree(&vkFont);
+
+	VulkanDestroyTexture(&vkPalette);
+	VulkanDestroyTexture(&vkIndexedTexture);
+
+	for(uint32_t i = 0; i < ARRAYLEN(vkTextures); ++i)
+	{
+		VulkanDestroyTexture(vkTextures + i);
+	}
+}
+
+
+static void
+VulkanRetirePipeline(
+	VkPipeline Pipeline
+	)
+{
+	VulkanRetire((Retired){ .Type = RETIRE_PIPELINE, .Pipeline = Pipeline });
+}
+
+
+static void
+VulkanRetirePipelines(
+	VkPipeline* Pipelines
+	)
+{
+	for(uint32_t i = 0; i < kPIPELINE; ++i)
+	{
+		VulkanRetirePipeline(Pipelines[i]);
+	}
+}
+
+
+static void
+VulkanRetireImage(
+	Image* Image
+	)
+{
+	VulkanRetire((Retired){ .Type = RETIRE_IMAGE, .Image = *Image });
+}
+
+
+static void
+VulkanRetireRenderPass(
+	VkRenderPass RenderPass
+	)
+{
+	VulkanRetire((Retired){ .Type = RETIRE_RENDER_PASS, .RenderPass = RenderPass });
+}
+
+
+static void
+VulkanRetireFramebuffers(
+	VkFramebuffer* Framebuffers
+	)
+{
+	VulkanRetire((Retired){ .Type = RETIRE_FRAMEBUFFERS, .Framebuffers = Framebuffers });
+}
+
+
+static void
+VulkanDestroyFramebuffers(
+	VkFramebuffer* Framebuffers
+	);
+
+
+/*
+ * Moves the completed frame and upload values forward with queries that
+ * never block, so retired objects go as soon as the GPU is done with them
+ * rather than when some later wait happens to cover them.
+ */
+static void
+VulkanPollCompleted(
+	void
+	)
+{
+	if(vkTimeline)
+	{
+		VkResult Result = vkGetSemaphoreCounterValue(vkDevice, vkFrameSemaphore, &vkFramesCompleted);
+		AssertEQ(Result, VK_SUCCESS);
+
+		Result = vkGetSemaphoreCounterValue(vkDevice, vkTransferSemaphore, &vkUploadsCompleted);
+		AssertEQ(Result, VK_SUCCESS);
+
+		return;
+	}
+
+	/* One queue finishes in submission order, the newest signaled fence covers the rest */
+	for(VkFrame* Frame = vkFrames; Frame != vkFrameEnd; ++Frame)
+	{
+		if(Frame->Value > vkFramesCompleted &&
+			vkGetFenceStatus(vkDevice, Frame->Fences[FENCE_IN_FLIGHT]) == VK_SUCCESS)
+		{
+			vkFramesCompleted = Frame->Value;
+		}
+	}
+
+	if(vkGetFenceStatus(vkDevice, vkFence) == VK_SUCCESS)
+	{
+		vkUploadsCompleted = vkTransferValue;
+	}
+}
+
+
+static void
+VulkanCollectRetired(
+	int All
+	)
+{
+	if(!All)
+	{
+		VulkanPollCompleted();
+	}
+
+	Retired* Object = vkRetired;
+	Retired* ObjectEnd = vkRetired + vkRetiredCount;
+	Retired* Kept = vkRetired;
+
+	for(; Object != ObjectEnd; ++Object)
+	{
+		if(!All && (Object->Frame > vkFramesCompleted || Object->Upload > vkUploadsCompleted))
+		{
+			*(Kept++) = *Object;
+			continue;
+		}
+
+		switch(Object->Type)
+		{
+			case RETIRE_PIPELINE:
+			{
+				vkDestroyPipeline(vkDevice, Object->Pipeline, NULL);
+				break;
+			}
+			case RETIRE_IMAGE:
+			{
+				VulkanDestroyImage(&Object->Image);
+				break;
+			}
+			case RETIRE_RENDER_PASS:
+			{
+				vkDestroyRenderPass(vkDevice, Object->RenderPass, NULL);
+				break;
+			}
+			case RETIRE_FRAMEBUFFERS:
+			{
+				VulkanDestroyFramebuffers(Object->Framebuffers);
+				break;
+			}
+			case RETIRE_BUFFER:
+			{
+				vkFreeMemory(vkDevice, Object->Memory, NULL);
+				vkDestroyBuffer(vkDevice, Object->Buffer, NULL);
+				break;
+			}
+			case RETIRE_HOST:
+			{
+				VulkanFreeHostNow(Object->Host);
+				break;
+			}
+			default:
+			{
+				AssertEQ(0, 1);
+			}
+		}
+	}
+
+	vkRetiredCount = Kept - vkRetired;
+
+	if(All)
+	{
+		free(vkRetired);
+		vkRetired = NULL;
+		vkRetiredSize = 0;
+	}
+}
+
+
+static void
+VulkanBuildGraph(
+	uint32_t ImageIndex
+	);
+
+
+/*
+ * Depth and the multisampled color image never leave the render pass, so
+ * they prefer lazily allocated memory, which a tiler never has to back.
+ */
+static uint32_t
+VulkanGetTransientMemory(
+	uint32_t Bits
+	)
+{
+	return VulkanFindMemory(Bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+}
+
+
+/*
+ * The graph owns the attachments. Building a frame once tells it which ones
+ * there are and which passes use them, which is all it needs to place them.
+ */
+static void
+VulkanInitAttachments(
+	void
+	)
+{
+	VulkanBuildGraph(0);
+	GraphAllocate(&vkGraph, vkDevice, VulkanGetTransientMemory);
+}
+
+
+static Image
+VulkanGetAttachment(
+	uint32_t Index
+	)
+{
+	const GraphImage* Transient = vkGraph.Images + Index;
+
+	Image Attachment = {0};
+	Attachment.Layers = 1;
+	Attachment.Image = Transient->Image;
+	Attachment.View = Transient->View;
+	Attachment.Memory = Transient->Memory;
+
+	return Attachment;
+}
+
+
+static void
+VulkanDestroyAttachments(
+	void
+	)
+{
+	for(uint32_t i = 0; i < vkGraph.ImageCount; ++i)
+	{
+		Image Attachment = VulkanGetAttachment(i);
+		VulkanDestroyImage(&Attachment);
+	}
+
+	GraphReleaseImages(&vkGraph);
+}
+
+
+static void
+VulkanInitOffscreen(
+	void
+	)
+{
+	if(!vkScaling)
+	{
+		vkOffscreen = (Image){0};
+		return;
+	}
+
+	VulkanCreateOffscreenImage(&vkOffscreen);
+}
+
+
+static void
+VulkanDestroyOffscreen(
+	void
+	)
+{
+	VulkanDestroyImage(&vkOffscreen);
+}
+
+
+/*
+ * Stands in for the swapchain during a check. The frames render into these
+ * and are never presented, the last pass still leaves them in the present
+ * layout so the graph does not need to know.
+ */
+static void
+VulkanInitHeadless(
+	void
+	)
+{
+	vkImageCount = vkMinImageCount;
+
+	vkHeadlessImages = calloc(vkImageCount, sizeof(*vkHeadlessImages));
+	AssertNEQ(vkHeadlessImages, NULL);
+
+	vkImages = malloc(sizeof(*vkImages) * vkImageCount);
+	AssertNEQ(vkImages, NULL);
+
+	vkImageViews = malloc(sizeof(*vkImageViews) * vkImageCount);
+	AssertNEQ(vkImageViews, NULL);
+
+	for(uint32_t i = 0; i < vkImageCount; ++i)
+	{
+		VulkanCreateImageGeneric(vkExtent.width, vkExtent.height, VK_FORMAT_B8G8R8A8_SRGB, 1,
+			VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+			VK_IMAGE_USAGE_TRANSFER_SRC_BIT | (vkScalingSupported ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0),
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkHeadlessImages + i);
+
+		vkImages[i] = vkHeadlessImages[i].Image;
+		vkImageViews[i] = vkHeadlessImages[i].View;
+	}
+}
+
+
+static void
+VulkanDestroyHeadless(
+	void
+	)
+{
+	for(uint32_t i = 0; i < vkImageCount; ++i)
+	{
+		VulkanDestroyImage(vkHeadlessImages + i);
+	}
+
+	free(vkImageViews);
+	free(vkImages);
+	free(vkHeadlessImages);
 }
 
 
@@ -1553,724 +3644,3913 @@ VulkanInitFramebuffers(
 	void
 	)
 {
-	VkImageView* ImageView = vkImageViews;
-	VkImageView* ImageViewEnd = vkImageViews + vkImageCount;
+	VkImageView* ImageView = vkImageViews;
+	VkImageView* ImageViewEnd = vkImageViews + vkImageCount;
+
+	vkFramebuffers = calloc(vkImageCount, sizeof(*vkFramebuffers));
+	AssertNEQ(vkFramebuffers, NULL);
+
+	VkFramebuffer* Framebuffer = vkFramebuffers;
+
+	while(1)
+	{
+		VkImageView Output = vkScaling ? vkOffscreen.View : *ImageView;
+
+		VkImageView Depth = GraphGetView(&vkGraph, vkDepthAttachment);
+
+		VkImageView Attachments[] =
+		{
+			vkColorAttachment != UINT32_MAX ? GraphGetView(&vkGraph, vkColorAttachment) : VK_NULL_HANDLE,
+			Depth,
+			Output
+		};
+
+		VkImageView SingleSampleAttachments[] =
+		{
+			Output,
+			Depth
+		};
+
+		VkFramebufferCreateInfo CreateInfo = {0};
+		CreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		CreateInfo.pNext = NULL;
+		CreateInfo.flags = 0;
+		CreateInfo.renderPass = vkRenderPass;
+
+		if(vkSamples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			CreateInfo.attachmentCount = ARRAYLEN(Attachments);
+			CreateInfo.pAttachments = Attachments;
+		}
+		else
+		{
+			CreateInfo.attachmentCount = ARRAYLEN(SingleSampleAttachments);
+			CreateInfo.pAttachments = SingleSampleAttachments;
+		}
+
+		CreateInfo.width = vkExtent.width;
+		CreateInfo.height = vkExtent.height;
+		CreateInfo.layers = 1;
+
+		VkResult Result = vkCreateFramebuffer(vkDevice, &CreateInfo, NULL, Framebuffer);
+		AssertEQ(Result, VK_SUCCESS);
+
+		if(++ImageView == ImageViewEnd)
+		{
+			break;
+		}
+
+		++Framebuffer;
+	}
+}
+
+
+static void
+VulkanDestroyFramebuffers(
+	VkFramebuffer* Framebuffers
+	)
+{
+	VkFramebuffer* Framebuffer = Framebuffers;
+	VkFramebuffer* FramebufferEnd = Framebuffers + vkImageCount;
+
+	do
+	{
+		vkDestroyFramebuffer(vkDevice, *Framebuffer, NULL);
+	}
+	while(++Framebuffer != FramebufferEnd);
+
+	free(Framebuffers);
+}
+
+
+static void
+VulkanInitRenderPass(
+	void
+	)
+{
+	int Resolve = vkSamples != VK_SAMPLE_COUNT_1_BIT;
+
+	VkImageLayout OutputLayout = vkScaling ?
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	VkAttachmentReference ColorAttachmentRef = {0};
+	ColorAttachmentRef.attachment = 0;
+	ColorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference DepthAttachmentRef = {0};
+	DepthAttachmentRef.attachment = 1;
+	DepthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference MultisamplingRef = {0};
+	MultisamplingRef.attachment = 2;
+	MultisamplingRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription Subpass = {0};
+	Subpass.flags = 0;
+	Subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	Subpass.inputAttachmentCount = 0;
+	Subpass.pInputAttachments = NULL;
+	Subpass.colorAttachmentCount = 1;
+	Subpass.pColorAttachments = &ColorAttachmentRef;
+	Subpass.pResolveAttachments = Resolve ? &MultisamplingRef : NULL;
+	Subpass.pDepthStencilAttachment = &DepthAttachmentRef;
+	Subpass.preserveAttachmentCount = 0;
+	Subpass.pPreserveAttachments = NULL;
+
+	VkSubpassDependency Dependency = {0};
+	Dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	Dependency.dstSubpass = 0;
+	Dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	Dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	Dependency.srcAccessMask = 0;
+	Dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	Dependency.dependencyFlags = 0;
+
+	/* Orders the offscreen writes and its move to TRANSFER_SRC before the upscale blit */
+	VkSubpassDependency Upscale = {0};
+	Upscale.srcSubpass = 0;
+	Upscale.dstSubpass = VK_SUBPASS_EXTERNAL;
+	Upscale.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	Upscale.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	Upscale.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	Upscale.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	Upscale.dependencyFlags = 0;
+
+	VkSubpassDependency Dependencies[] = { Dependency, Upscale };
+
+	VkAttachmentDescription Attachments[3] = {0};
+
+	Attachments[0].flags = 0;
+	Attachments[0].format = VK_FORMAT_B8G8R8A8_SRGB;
+	Attachments[0].samples = vkSamples;
+	Attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	Attachments[0].storeOp = Resolve ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+	Attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	Attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	Attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	Attachments[0].finalLayout = Resolve ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : OutputLayout;
+
+	Attachments[1].flags = 0;
+	Attachments[1].format = VK_FORMAT_D32_SFLOAT;
+	Attachments[1].samples = vkSamples;
+	Attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	Attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	Attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	Attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	Attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	Attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	Attachments[2].flags = 0;
+	Attachments[2].format = VK_FORMAT_B8G8R8A8_SRGB;
+	Attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
+	Attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	Attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	Attachments[2].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	Attachments[2].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	Attachments[2].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	Attachments[2].finalLayout = OutputLayout;
+
+	VkRenderPassCreateInfo RenderPassInfo = {0};
+	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	RenderPassInfo.pNext = NULL;
+	RenderPassInfo.flags = 0;
+	RenderPassInfo.attachmentCount = Resolve ? 3 : 2;
+	RenderPassInfo.pAttachments = Attachments;
+	RenderPassInfo.subpassCount = 1;
+	RenderPassInfo.pSubpasses = &Subpass;
+	RenderPassInfo.dependencyCount = vkScaling ? 2 : 1;
+	RenderPassInfo.pDependencies = Dependencies;
+
+	VkResult Result = vkCreateRenderPass(vkDevice, &RenderPassInfo, NULL, &vkRenderPass);
+	AssertEQ(Result, VK_SUCCESS);
+}
+
+
+/*
+ * Everything the overdraw view needs apart from its two pipelines, which
+ * follow the scene pass and are rebuilt along with the others. Only set up
+ * when VULKAN_HEATMAP is set or for a regression run, the H key then
+ * switches the view.
+ */
+static void
+VulkanInitHeatMap(
+	void
+	)
+{
+	if(getenv("VULKAN_HEATMAP") == NULL && !vkChecking)
+	{
+		return;
+	}
+
+	VulkanCreateImageGeneric(vkExtent.width, vkExtent.height, VK_FORMAT_R16_SFLOAT, 1,
+		VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vkHeatImage);
+
+	VkAttachmentReference CountRef = {0};
+	CountRef.attachment = 0;
+	CountRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription Subpass = {0};
+	Subpass.flags = 0;
+	Subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	Subpass.inputAttachmentCount = 0;
+	Subpass.pInputAttachments = NULL;
+	Subpass.colorAttachmentCount = 1;
+	Subpass.pColorAttachments = &CountRef;
+	Subpass.pResolveAttachments = NULL;
+	Subpass.pDepthStencilAttachment = NULL;
+	Subpass.preserveAttachmentCount = 0;
+	Subpass.pPreserveAttachments = NULL;
+
+	VkSubpassDependency Dependency = {0};
+	Dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	Dependency.dstSubpass = 0;
+	Dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	Dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	Dependency.srcAccessMask = 0;
+	Dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	Dependency.dependencyFlags = 0;
+
+	VkAttachmentDescription Attachment = {0};
+	Attachment.flags = 0;
+	Attachment.format = VK_FORMAT_R16_SFLOAT;
+	Attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	Attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	Attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	Attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	Attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	Attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	Attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkRenderPassCreateInfo RenderPassInfo = {0};
+	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	RenderPassInfo.pNext = NULL;
+	RenderPassInfo.flags = 0;
+	RenderPassInfo.attachmentCount = 1;
+	RenderPassInfo.pAttachments = &Attachment;
+	RenderPassInfo.subpassCount = 1;
+	RenderPassInfo.pSubpasses = &Subpass;
+	RenderPassInfo.dependencyCount = 1;
+	RenderPassInfo.pDependencies = &Dependency;
+
+	VkResult Result = vkCreateRenderPass(vkDevice, &RenderPassInfo, NULL, &vkHeatRenderPass);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VkFramebufferCreateInfo FramebufferInfo = {0};
+	FramebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	FramebufferInfo.pNext = NULL;
+	FramebufferInfo.flags = 0;
+	FramebufferInfo.renderPass = vkHeatRenderPass;
+	FramebufferInfo.attachmentCount = 1;
+	FramebufferInfo.pAttachments = &vkHeatImage.View;
+	FramebufferInfo.width = vkExtent.width;
+	FramebufferInfo.height = vkExtent.height;
+	FramebufferInfo.layers = 1;
+
+	Result = vkCreateFramebuffer(vkDevice, &FramebufferInfo, NULL, &vkHeatFramebuffer);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VkDescriptorSetLayoutBinding Binding = {0};
+	Binding.binding = 0;
+	Binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	Binding.descriptorCount = 1;
+	Binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	Binding.pImmutableSamplers = NULL;
+
+	VkDescriptorSetLayoutCreateInfo Descriptors = {0};
+	Descriptors.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	Descriptors.pNext = NULL;
+	Descriptors.flags = 0;
+	Descriptors.bindingCount = 1;
+	Descriptors.pBindings = &Binding;
+
+	Result = vkCreateDescriptorSetLayout(vkDevice, &Descriptors, NULL, &vkHeatDescriptors);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VkDescriptorPoolSize PoolSize = {0};
+	PoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	PoolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo DescriptorInfo = {0};
+	DescriptorInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	DescriptorInfo.pNext = NULL;
+	DescriptorInfo.flags = 0;
+	DescriptorInfo.maxSets = 1;
+	DescriptorInfo.poolSizeCount = 1;
+	DescriptorInfo.pPoolSizes = &PoolSize;
+
+	Result = vkCreateDescriptorPool(vkDevice, &DescriptorInfo, NULL, &vkHeatDescriptorPool);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VkDescriptorSetAllocateInfo AllocInfo = {0};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	AllocInfo.pNext = NULL;
+	AllocInfo.descriptorPool = vkHeatDescriptorPool;
+	AllocInfo.descriptorSetCount = 1;
+	AllocInfo.pSetLayouts = &vkHeatDescriptors;
+
+	Result = vkAllocateDescriptorSets(vkDevice, &AllocInfo, &vkHeatSet);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VkDescriptorImageInfo ImageInfo = {0};
+	ImageInfo.sampler = vkSampler;
+	ImageInfo.imageView = vkHeatImage.View;
+	ImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet Write = {0};
+	Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	Write.pNext = NULL;
+	Write.dstSet = vkHeatSet;
+	Write.dstBinding = 0;
+	Write.dstArrayElement = 0;
+	Write.descriptorCount = 1;
+	Write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	Write.pImageInfo = &ImageInfo;
+	Write.pBufferInfo = NULL;
+	Write.pTexelBufferView = NULL;
+
+	vkUpdateDescriptorSets(vkDevice, 1, &Write, 0, NULL);
+
+	VkPipelineLayoutCreateInfo LayoutInfo = {0};
+	LayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	LayoutInfo.pNext = NULL;
+	LayoutInfo.flags = 0;
+	LayoutInfo.setLayoutCount = 1;
+	LayoutInfo.pSetLayouts = &vkHeatDescriptors;
+	LayoutInfo.pushConstantRangeCount = 0;
+	LayoutInfo.pPushConstantRanges = NULL;
+
+	Result = vkCreatePipelineLayout(vkDevice, &LayoutInfo, NULL, &vkHeatLayout);
+	AssertEQ(Result, VK_SUCCESS);
+}
+
+
+static void
+VulkanDestroyHeatMap(
+	void
+	)
+{
+	if(vkHeatRenderPass == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkDestroyPipelineLayout(vkDevice, vkHeatLayout, NULL);
+	vkDestroyDescriptorPool(vkDevice, vkHeatDescriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(vkDevice, vkHeatDescriptors, NULL);
+	vkDestroyFramebuffer(vkDevice, vkHeatFramebuffer, NULL);
+	vkDestroyRenderPass(vkDevice, vkHeatRenderPass, NULL);
+
+	VulkanDestroyImage(&vkHeatImage);
+}
+
+
+/*
+ * Kind is a blend mode or one of the debug pipelines. The heat pipeline
+ * draws the same geometry into the single sampled heat pass and counts
+ * fragments, the heat map one is a full screen triangle in the scene pass.
+ */
+static int
+VulkanTryCreateGraphicsPipeline(
+	uint32_t Kind,
+	VkPipeline* Pipeline
+	)
+{
+	BlendMode Blend = Kind < kBLEND ? Kind : BLEND_ADDITIVE;
+	int Heat = Kind == PIPELINE_HEAT;
+	int HeatMap = Kind == PIPELINE_HEAT_MAP;
+
+	const char* VertexPath = vkVertexPulling ? "bin/pull.spv" : "bin/vert.spv";
+	const char* FragmentPath = vkBindless ? "bin/bindless.spv" : "bin/frag.spv";
+
+	if(Heat)
+	{
+		FragmentPath = "bin/heat.spv";
+	}
+
+	if(HeatMap)
+	{
+		VertexPath = "bin/fullscreen.spv";
+		FragmentPath = "bin/heatmap.spv";
+	}
+
+	VkShaderModule VertexModule;
+	VkShaderModule FragmentModule;
+
+	if(VulkanTryCreateShader(VertexPath, &VertexModule) == -1)
+	{
+		return -1;
+	}
+
+	if(VulkanTryCreateShader(FragmentPath, &FragmentModule) == -1)
+	{
+		VulkanDestroyShader(VertexModule);
+		return -1;
+	}
+
+	VkPipelineShaderStageCreateInfo Stages[2] = {0};
+
+	Stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	Stages[0].pNext = NULL;
+	Stages[0].flags = 0;
+	Stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	Stages[0].module = VertexModule;
+	Stages[0].pName = "main";
+	Stages[0].pSpecializationInfo = NULL;
+
+	Stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	Stages[1].pNext = NULL;
+	Stages[1].flags = 0;
+	Stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	Stages[1].module = FragmentModule;
+	Stages[1].pName = "main";
+	Stages[1].pSpecializationInfo = NULL;
+
+	VkVertexInputBindingDescription VertexBindings[2] = {0};
+
+	VertexBindings[0].binding = 0;
+	VertexBindings[0].stride = sizeof(VkVertexVertexInput);
+	VertexBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	VertexBindings[1].binding = 1;
+	VertexBindings[1].stride = sizeof(VkVertexInstanceInput);
+	VertexBindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	VkVertexInputAttributeDescription Attributes[10] = {0};
+
+	Attributes[0].location = 0;
+	Attributes[0].binding = 0;
+	Attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	Attributes[0].offset = offsetof(VkVertexVertexInput, Position);
+
+	Attributes[1].location = 1;
+	Attributes[1].binding = 0;
+	Attributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+	Attributes[1].offset = offsetof(VkVertexVertexInput, TexCoord);
+
+	Attributes[2].location = 2;
+	Attributes[2].binding = 1;
+	Attributes[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+	Attributes[2].offset = offsetof(VkVertexInstanceInput, Position);
+
+	Attributes[3].location = 3;
+	Attributes[3].binding = 1;
+	Attributes[3].format = VK_FORMAT_R32G32_SFLOAT;
+	Attributes[3].offset = offsetof(VkVertexInstanceInput, Dimensions);
+
+	Attributes[4].location = 4;
+	Attributes[4].binding = 1;
+	Attributes[4].format = VK_FORMAT_R32_SFLOAT;
+	Attributes[4].offset = offsetof(VkVertexInstanceInput, Rotation);
+
+	Attributes[5].location = 5;
+	Attributes[5].binding = 1;
+	Attributes[5].format = VK_FORMAT_R32_UINT;
+	Attributes[5].offset = offsetof(VkVertexInstanceInput, TexIndex);
+
+	Attributes[6].location = 6;
+	Attributes[6].binding = 1;
+	Attributes[6].format = VK_FORMAT_R32_UINT;
+	Attributes[6].offset = offsetof(VkVertexInstanceInput, Palette);
+
+	Attributes[7].location = 7;
+	Attributes[7].binding = 1;
+	Attributes[7].format = VK_FORMAT_R32_UINT;
+	Attributes[7].offset = offsetof(VkVertexInstanceInput, Texture);
+
+	Attributes[8].location = 8;
+	Attributes[8].binding = 1;
+	Attributes[8].format = VK_FORMAT_R8G8B8A8_UNORM;
+	Attributes[8].offset = offsetof(VkVertexInstanceInput, Color);
+
+	Attributes[9].location = 9;
+	Attributes[9].binding = 1;
+	Attributes[9].format = VK_FORMAT_R32_UINT;
+	Attributes[9].offset = offsetof(VkVertexInstanceInput, Flags);
+
+	VkPipelineVertexInputStateCreateInfo VertexInput = {0};
+	VertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	VertexInput.pNext = NULL;
+	VertexInput.flags = 0;
+	VertexInput.vertexBindingDescriptionCount = vkVertexPulling || HeatMap ? 0 : ARRAYLEN(VertexBindings);
+	VertexInput.pVertexBindingDescriptions = VertexBindings;
+	VertexInput.vertexAttributeDescriptionCount = vkVertexPulling || HeatMap ? 0 : ARRAYLEN(Attributes);
+	VertexInput.pVertexAttributeDescriptions = Attributes;
+
+	VkPipelineInputAssemblyStateCreateInfo InputAssembly = {0};
+	InputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	InputAssembly.pNext = NULL;
+	InputAssembly.flags = 0;
+	InputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+	InputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo ViewportState = {0};
+	ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	ViewportState.pNext = NULL;
+	ViewportState.flags = 0;
+	ViewportState.viewportCount = 1;
+	ViewportState.pViewports = NULL;
+	ViewportState.scissorCount = 1;
+	ViewportState.pScissors = NULL;
+
+	VkDynamicState DynamicStates[] =
+	{
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo DynamicState = {0};
+	DynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	DynamicState.pNext = NULL;
+	DynamicState.flags = 0;
+	DynamicState.dynamicStateCount = ARRAYLEN(DynamicStates);
+	DynamicState.pDynamicStates = DynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo Rasterizer = {0};
+	Rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	Rasterizer.pNext = NULL;
+	Rasterizer.flags = 0;
+	Rasterizer.depthClampEnable = VK_FALSE;
+	Rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	Rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	Rasterizer.cullMode = VK_CULL_MODE_NONE; // VK_CULL_MODE_BACK_BIT;
+	Rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	Rasterizer.depthBiasEnable = VK_FALSE;
+	Rasterizer.depthBiasConstantFactor = 0.0f;
+	Rasterizer.depthBiasClamp = 0.0f;
+	Rasterizer.depthBiasSlopeFactor = 0.0f;
+	Rasterizer.lineWidth = 1.0f;
+
+	VkPipelineMultisampleStateCreateInfo Multisampling = {0};
+	Multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	Multisampling.pNext = NULL;
+	Multisampling.flags = 0;
+	Multisampling.rasterizationSamples = Heat ? VK_SAMPLE_COUNT_1_BIT : vkSamples;
+	Multisampling.sampleShadingEnable = Kind < kBLEND ? vkSampleShading : VK_FALSE;
+	Multisampling.minSampleShading = 1.0f;
+	Multisampling.pSampleMask = NULL;
+	Multisampling.alphaToCoverageEnable = Kind < kBLEND;
+	Multisampling.alphaToOneEnable = VK_FALSE;
+
+	VkPipelineDepthStencilStateCreateInfo DepthStencil = {0};
+	DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	DepthStencil.pNext = NULL;
+	DepthStencil.flags = 0;
+	DepthStencil.depthTestEnable = Kind < kBLEND;
+	DepthStencil.depthWriteEnable = Kind < kBLEND && Blend == BLEND_ALPHA;
+	DepthStencil.depthCompareOp = VK_COMPARE_OP_GREATER;
+	DepthStencil.depthBoundsTestEnable = VK_FALSE;
+	DepthStencil.stencilTestEnable = VK_FALSE;
+	DepthStencil.front = (VkStencilOpState){0};
+	DepthStencil.back = (VkStencilOpState){0};
+	DepthStencil.minDepthBounds = 0.0f;
+	DepthStencil.maxDepthBounds = 0.0f;
+
+	VkPipelineColorBlendAttachmentState BlendingAttachment = {0};
+	BlendingAttachment.blendEnable = !HeatMap;
+	BlendingAttachment.srcColorBlendFactor = Heat ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_SRC_ALPHA;
+	BlendingAttachment.dstColorBlendFactor =
+		Blend == BLEND_ADDITIVE ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	BlendingAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	BlendingAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	BlendingAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	BlendingAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	BlendingAttachment.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo Blending = {0};
+	Blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	Blending.pNext = NULL;
+	Blending.flags = 0;
+	Blending.logicOpEnable = VK_FALSE;
+	Blending.logicOp = VK_LOGIC_OP_COPY;
+	Blending.attachmentCount = 1;
+	Blending.pAttachments = &BlendingAttachment;
+	Blending.blendConstants[0] = 0.0f;
+	Blending.blendConstants[1] = 0.0f;
+	Blending.blendConstants[2] = 0.0f;
+	Blending.blendConstants[3] = 0.0f;
+
+	VkGraphicsPipelineCreateInfo PipelineInfo = {0};
+	PipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	PipelineInfo.pNext = NULL;
+	PipelineInfo.flags = 0;
+	PipelineInfo.stageCount = 2;
+	PipelineInfo.pStages = Stages;
+	PipelineInfo.pVertexInputState = &VertexInput;
+	PipelineInfo.pInputAssemblyState = &InputAssembly;
+	PipelineInfo.pTessellationState = NULL;
+	PipelineInfo.pViewportState = &ViewportState;
+	PipelineInfo.pRasterizationState = &Rasterizer;
+	PipelineInfo.pMultisampleState = &Multisampling;
+	PipelineInfo.pDepthStencilState = &DepthStencil;
+	PipelineInfo.pColorBlendState = &Blending;
+	PipelineInfo.pDynamicState = &DynamicState;
+	PipelineInfo.layout = HeatMap ? vkHeatLayout : vkPipelineLayout;
+	PipelineInfo.renderPass = Heat ? vkHeatRenderPass : vkRenderPass;
+	PipelineInfo.subpass = 0;
+	PipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	PipelineInfo.basePipelineIndex = -1;
+
+	VkResult Result = vkCreateGraphicsPipelines(vkDevice, VK_NULL_HANDLE, 1, &PipelineInfo, NULL, Pipeline);
+
+	VulkanDestroyShader(VertexModule);
+	VulkanDestroyShader(FragmentModule);
+
+	return Result == VK_SUCCESS ? 0 : -1;
+}
+
+
+/*
+ * Builds every pipeline or none of them, so a bad shader never leaves a
+ * half replaced set behind.
+ */
+static int
+VulkanTryCreateGraphicsPipelines(
+	VkPipeline* Pipelines
+	)
+{
+	for(uint32_t i = 0; i < kPIPELINE; ++i)
+	{
+		Pipelines[i] = VK_NULL_HANDLE;
+
+		if(i >= kBLEND && vkHeatRenderPass == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		if(VulkanTryCreateGraphicsPipeline(i, Pipelines + i) == -1)
+		{
+			while(i-- > 0)
+			{
+				vkDestroyPipeline(vkDevice, Pipelines[i], NULL);
+				Pipelines[i] = VK_NULL_HANDLE;
+			}
+
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * The bindless path sees every sheet through one set. Otherwise there is one
+ * set per sheet and the draw list switches between them.
+ */
+static uint32_t
+VulkanGetDescriptorSetCount(
+	void
+	)
+{
+	return vkBindless ? 1 : ARRAYLEN(vkTexturePaths);
+}
+
+
+static void
+VulkanCreateGraphicsPipelines(
+	VkPipeline* Pipelines
+	)
+{
+	int Error = VulkanTryCreateGraphicsPipelines(Pipelines);
+	AssertEQ(Error, 0);
+}
+
+
+static void
+VulkanDestroyGraphicsPipelines(
+	VkPipeline* Pipelines
+	)
+{
+	for(uint32_t i = 0; i < kPIPELINE; ++i)
+	{
+		vkDestroyPipeline(vkDevice, Pipelines[i], NULL);
+	}
+}
+
+
+/*
+ * In the heat pass every draw goes through the counting pipeline instead
+ * of the one its blend mode asks for.
+ */
+static VkPipeline
+VulkanGetPipeline(
+	uint32_t Blend
+	)
+{
+	return vkPipelines[vkHeatRecording ? PIPELINE_HEAT : Blend];
+}
+
+
+static void
+VulkanInitPipeline(
+	void
+	)
+{
+	for(uint32_t i = 0; i < ARRAYLEN(vkTexturePaths); ++i)
+	{
+		Pixels Pixels;
+		VulkanLoadPixels(vkTexturePaths[i], &Pixels);
+		VulkanCreateTextures(&Pixels, i);
+		VulkanFreePixels(&Pixels);
+	}
+
+	VulkanCreateFontTexture();
+
+	VulkanInitRenderPass();
+
+
+	VkDescriptorSetLayoutBinding Bindings[5] = {0};
+
+	Bindings[0].binding = 0;
+	Bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	Bindings[0].descriptorCount = vkBindless ? vkTextureSlots : 1;
+	Bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	Bindings[0].pImmutableSamplers = NULL;
+
+	Bindings[1].binding = 1;
+	Bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	Bindings[1].descriptorCount = 1;
+	Bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	Bindings[1].pImmutableSamplers = NULL;
+
+	Bindings[2].binding = 2;
+	Bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	Bindings[2].descriptorCount = 1;
+	Bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	Bindings[2].pImmutableSamplers = NULL;
+
+	Bindings[3].binding = 3;
+	Bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	Bindings[3].descriptorCount = 1;
+	Bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	Bindings[3].pImmutableSamplers = NULL;
+
+	Bindings[4].binding = 4;
+	Bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	Bindings[4].descriptorCount = 1;
+	Bindings[4].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	Bindings[4].pImmutableSamplers = NULL;
+
+	VkDescriptorBindingFlags BindingFlags[5] = {0};
+	BindingFlags[0] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo Flags = {0};
+	Flags.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	Flags.pNext = NULL;
+	Flags.bindingCount = ARRAYLEN(BindingFlags);
+	Flags.pBindingFlags = BindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo Descriptors = {0};
+	Descriptors.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	Descriptors.pNext = vkBindless ? &Flags : NULL;
+	Descriptors.flags = 0;
+	Descriptors.bindingCount = ARRAYLEN(Bindings);
+	Descriptors.pBindings = Bindings;
+
+	VkResult Result = vkCreateDescriptorSetLayout(vkDevice, &Descriptors, NULL, &vkDescriptors);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VkDescriptorSetLayoutBinding InstanceBinding = {0};
+	InstanceBinding.binding = 0;
+	InstanceBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	InstanceBinding.descriptorCount = 1;
+	InstanceBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	InstanceBinding.pImmutableSamplers = NULL;
+
+	Descriptors.pNext = NULL;
+	Descriptors.bindingCount = 1;
+	Descriptors.pBindings = &InstanceBinding;
+
+	Result = vkCreateDescriptorSetLayout(vkDevice, &Descriptors, NULL, &vkInstanceDescriptors);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VkDescriptorSetLayout SetLayouts[2] = { vkDescriptors, vkInstanceDescriptors };
+
+	VkPipelineLayoutCreateInfo CreateInfo = {0};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	CreateInfo.pNext = NULL;
+	CreateInfo.flags = 0;
+	CreateInfo.setLayoutCount = vkVertexPulling ? 2 : 1;
+	CreateInfo.pSetLayouts = SetLayouts;
+	CreateInfo.pushConstantRangeCount = 0;
+	CreateInfo.pPushConstantRanges = NULL;
+
+	Result = vkCreatePipelineLayout(vkDevice, &CreateInfo, NULL, &vkPipelineLayout);
+	AssertEQ(Result, VK_SUCCESS);
+
+
+	VulkanCreateGraphicsPipelines(vkPipelines);
+
+
+	VulkanInitFramebuffers();
+
+
+	VkDescriptorPoolSize PoolSizes[2] = {0};
+
+	PoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	PoolSizes[0].descriptorCount = vkImageCount * VulkanGetDescriptorSetCount();
+
+	PoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	PoolSizes[1].descriptorCount = vkImageCount * VulkanGetDescriptorSetCount() * (Bindings[0].descriptorCount + 3);
+
+	VkDescriptorPoolCreateInfo DescriptorInfo = {0};
+	DescriptorInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	DescriptorInfo.pNext = NULL;
+	DescriptorInfo.flags = 0;
+	DescriptorInfo.maxSets = vkImageCount * VulkanGetDescriptorSetCount();
+	DescriptorInfo.poolSizeCount = ARRAYLEN(PoolSizes);
+	DescriptorInfo.pPoolSizes = PoolSizes;
+
+	Result = vkCreateDescriptorPool(vkDevice, &DescriptorInfo, NULL, &vkDescriptorPool);
+	AssertEQ(Result, VK_SUCCESS);
+
+	/* One instance set per frame, plus the tilemap and the particles */
+	uint32_t InstanceSets = (vkFrameEnd - vkFrames) + 2;
+
+	PoolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	PoolSizes[0].descriptorCount = InstanceSets;
+
+	DescriptorInfo.maxSets = InstanceSets;
+	DescriptorInfo.poolSizeCount = 1;
+
+	Result = vkCreateDescriptorPool(vkDevice, &DescriptorInfo, NULL, &vkInstanceDescriptorPool);
+	AssertEQ(Result, VK_SUCCESS);
+}
+
+
+static void
+VulkanDestroyPipeline(
+	void
+	)
+{
+	vkDestroyDescriptorPool(vkDevice, vkInstanceDescriptorPool, NULL);
+	vkDestroyDescriptorPool(vkDevice, vkDescriptorPool, NULL);
+
+	VulkanDestroyFramebuffers(vkFramebuffers);
+
+	VulkanDestroyGraphicsPipelines(vkPipelines);
+	vkDestroyPipelineLayout(vkDevice, vkPipelineLayout, NULL);
+	vkDestroyDescriptorSetLayout(vkDevice, vkInstanceDescriptors, NULL);
+	vkDestroyDescriptorSetLayout(vkDevice, vkDescriptors, NULL);
+	vkDestroyRenderPass(vkDevice, vkRenderPass, NULL);
+
+	VulkanDestroyTextures();
+}
+
+
+static void
+VulkanWriteInstanceSet(
+	VkDescriptorSet Set,
+	VkBuffer Buffer
+	)
+{
+	VkDescriptorBufferInfo BufferInfo = {0};
+	BufferInfo.buffer = Buffer;
+	BufferInfo.offset = 0;
+	BufferInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet DescriptorWrite = {0};
+	DescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	DescriptorWrite.pNext = NULL;
+	DescriptorWrite.dstSet = Set;
+	DescriptorWrite.dstBinding = 0;
+	DescriptorWrite.dstArrayElement = 0;
+	DescriptorWrite.descriptorCount = 1;
+	DescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	DescriptorWrite.pImageInfo = NULL;
+	DescriptorWrite.pBufferInfo = &BufferInfo;
+	DescriptorWrite.pTexelBufferView = NULL;
+
+	vkUpdateDescriptorSets(vkDevice, 1, &DescriptorWrite, 0, NULL);
+}
+
+
+/*
+ * With vertex pulling the shader reads instances from a storage buffer in
+ * set 1 instead of vertex binding 1, every instance source gets its own set.
+ */
+static VkDescriptorSet
+VulkanCreateInstanceSet(
+	VkBuffer Buffer
+	)
+{
+	if(!vkVertexPulling)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	VkDescriptorSetAllocateInfo AllocInfo = {0};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	AllocInfo.pNext = NULL;
+	AllocInfo.descriptorPool = vkInstanceDescriptorPool;
+	AllocInfo.descriptorSetCount = 1;
+	AllocInfo.pSetLayouts = &vkInstanceDescriptors;
+
+	VkDescriptorSet Set;
+
+	VkResult Result = vkAllocateDescriptorSets(vkDevice, &AllocInfo, &Set);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VulkanWriteInstanceSet(Set, Buffer);
+
+	return Set;
+}
+
+
+static void
+VulkanBindInstances(
+	VkBuffer Buffer,
+	VkDescriptorSet Set
+	)
+{
+	if(vkVertexPulling)
+	{
+		vkCmdBindDescriptorSets(vkFrame->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			vkPipelineLayout, 1, 1, &Set, 0, NULL);
+	}
+	else
+	{
+		VkDeviceSize Offset = 0;
+		vkCmdBindVertexBuffers(vkFrame->CommandBuffer, 1, 1, &Buffer, &Offset);
+	}
+}
+
+
+static void
+VulkanUpdateDescriptors(
+	VkFrame* Frame
+	)
+{
+	VkDescriptorImageInfo Textures[ARRAYLEN(vkTextures)] = {0};
+
+	/* The empty slot of sheet 0 still needs a float view, it is never sampled */
+	for(uint32_t i = 0; i < ARRAYLEN(vkTextures); ++i)
+	{
+		Textures[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		Textures[i].imageView = i == 0 ? vkPalette.View : vkTextures[i].View;
+		Textures[i].sampler = vkSampler;
+	}
+
+	VkDescriptorImageInfo ImageInfos[3] = {0};
+
+	ImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	ImageInfos[0].imageView = vkIndexedTexture.View;
+	ImageInfos[0].sampler = vkSampler;
+
+	ImageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	ImageInfos[1].imageView = vkPalette.View;
+	ImageInfos[1].sampler = vkSampler;
+
+	ImageInfos[2].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	ImageInfos[2].imageView = vkFontTexture.View;
+	ImageInfos[2].sampler = vkFontSampler;
+
+	VkDescriptorBufferInfo BufferInfo = {0};
+	BufferInfo.buffer = Frame->Constants;
+	BufferInfo.offset = offsetof(VkFrameConstantInput, Vertex);
+	BufferInfo.range = sizeof(VkVertexConstantInput);
+
+	for(uint32_t i = 0; i < VulkanGetDescriptorSetCount(); ++i)
+	{
+		VkWriteDescriptorSet DescriptorWrites[3] = {0};
+
+		DescriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		DescriptorWrites[0].pNext = NULL;
+		DescriptorWrites[0].dstSet = Frame->DescriptorSets[i];
+		DescriptorWrites[0].dstBinding = 0;
+		DescriptorWrites[0].dstArrayElement = 0;
+		DescriptorWrites[0].descriptorCount = vkBindless ? ARRAYLEN(Textures) : 1;
+		DescriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		DescriptorWrites[0].pImageInfo = Textures + i;
+		DescriptorWrites[0].pBufferInfo = NULL;
+		DescriptorWrites[0].pTexelBufferView = NULL;
+
+		DescriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		DescriptorWrites[1].pNext = NULL;
+		DescriptorWrites[1].dstSet = Frame->DescriptorSets[i];
+		DescriptorWrites[1].dstBinding = 1;
+		DescriptorWrites[1].dstArrayElement = 0;
+		DescriptorWrites[1].descriptorCount = ARRAYLEN(ImageInfos);
+		DescriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		DescriptorWrites[1].pImageInfo = ImageInfos;
+		DescriptorWrites[1].pBufferInfo = NULL;
+		DescriptorWrites[1].pTexelBufferView = NULL;
+
+		DescriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		DescriptorWrites[2].pNext = NULL;
+		DescriptorWrites[2].dstSet = Frame->DescriptorSets[i];
+		DescriptorWrites[2].dstBinding = 4;
+		DescriptorWrites[2].dstArrayElement = 0;
+		DescriptorWrites[2].descriptorCount = 1;
+		DescriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		DescriptorWrites[2].pImageInfo = NULL;
+		DescriptorWrites[2].pBufferInfo = &BufferInfo;
+		DescriptorWrites[2].pTexelBufferView = NULL;
+
+		vkUpdateDescriptorSets(vkDevice, ARRAYLEN(DescriptorWrites), DescriptorWrites, 0, NULL);
+	}
+
+	/* Recordings that bound these sets are invalid once they are rewritten */
+	Frame->StaleDescriptors = 0;
+	++vkRecordGeneration;
+}
+
+
+/*
+ * Written once per frame front to back, so device local memory the host
+ * can see is a win.
+ */
+static void
+VulkanCreateFrameInstances(
+	VkFrame* Frame,
+	uint32_t Capacity
+	)
+{
+	VulkanGetPreferredBuffer(sizeof(*Frame->InstanceData) * Capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&Frame->Instances, &Frame->InstanceMemory);
+
+	VkResult Result = vkMapMemory(vkDevice, Frame->InstanceMemory, 0, VK_WHOLE_SIZE, 0, (void**) &Frame->InstanceData);
+	AssertEQ(Result, VK_SUCCESS);
+
+	Frame->InstanceCapacity = Capacity;
+}
+
+
+/*
+ * Makes room for Count instances in the current frame's buffer. Its fence
+ * has been waited for, but the old buffer still goes through the retire
+ * queue, and every reusable recording is dropped because it points at it.
+ */
+static void
+VulkanGrowFrameInstances(
+	uint32_t Count
+	)
+{
+	if(Count <= vkFrame->InstanceCapacity)
+	{
+		return;
+	}
+
+	uint32_t Capacity = vkFrame->InstanceCapacity;
+
+	while(Capacity < Count)
+	{
+		Capacity <<= 1;
+	}
+
+	vkUnmapMemory(vkDevice, vkFrame->InstanceMemory);
+	VulkanRetireBuffer(vkFrame->Instances, vkFrame->InstanceMemory);
+
+	VulkanCreateFrameInstances(vkFrame, Capacity);
+
+	if(vkFrame->InstanceSet != VK_NULL_HANDLE)
+	{
+		VulkanWriteInstanceSet(vkFrame->InstanceSet, vkFrame->Instances);
+	}
+
+	++vkRecordGeneration;
+}
+
+
+static void
+VulkanInitObjects(
+	void
+	)
+{
+	VkFrame* Frame = vkFrames;
+
+	do
+	{
+		VkSemaphoreCreateInfo SemaphoreInfo = {0};
+		SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		SemaphoreInfo.pNext = NULL;
+		SemaphoreInfo.flags = 0;
+
+		VkSemaphore* Semaphore = Frame->Semaphores;
+		VkSemaphore* SemaphoreEnd = Frame->Semaphores + ARRAYLEN(Frame->Semaphores);
+
+		do
+		{
+			VkResult Result = vkCreateSemaphore(vkDevice, &SemaphoreInfo, NULL, Semaphore);
+			AssertEQ(Result, VK_SUCCESS);
+		}
+		while(++Semaphore != SemaphoreEnd);
+
+
+		VkFenceCreateInfo FenceInfo = {0};
+		FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		FenceInfo.pNext = NULL;
+		FenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		VkFence* Fence = Frame->Fences;
+		VkFence* FenceEnd = Frame->Fences + ARRAYLEN(Frame->Fences);
+
+		do
+		{
+			*Fence = VK_NULL_HANDLE;
+
+			if(!vkTimeline)
+			{
+				VkResult Result = vkCreateFence(vkDevice, &FenceInfo, NULL, Fence);
+				AssertEQ(Result, VK_SUCCESS);
+			}
+		}
+		while(++Fence != FenceEnd);
+
+		Frame->Value = 0;
+
+
+		VkDescriptorSetLayout Layouts[ARRAYLEN(Frame->DescriptorSets)];
+
+		for(uint32_t i = 0; i < ARRAYLEN(Layouts); ++i)
+		{
+			Layouts[i] = vkDescriptors;
+		}
+
+		VkDescriptorSetAllocateInfo AllocInfo = {0};
+		AllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		AllocInfo.pNext = NULL;
+		AllocInfo.descriptorPool = vkDescriptorPool;
+		AllocInfo.descriptorSetCount = VulkanGetDescriptorSetCount();
+		AllocInfo.pSetLayouts = Layouts;
+
+		VkResult Result = vkAllocateDescriptorSets(vkDevice, &AllocInfo, Frame->DescriptorSets);
+		AssertEQ(Result, VK_SUCCESS);
+
+
+		VulkanGetBuffer(sizeof(*Frame->ConstantData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &Frame->Constants, &Frame->ConstantMemory);
+
+		Result = vkMapMemory(vkDevice, Frame->ConstantMemory, 0, VK_WHOLE_SIZE, 0, (void**) &Frame->ConstantData);
+		AssertEQ(Result, VK_SUCCESS);
+
+
+		VulkanUpdateDescriptors(Frame);
+
+
+		VulkanCreateFrameInstances(Frame, vkInstanceCapacity);
+		Frame->InstanceSet = VulkanCreateInstanceSet(Frame->Instances);
+
+
+		VulkanGetStagingBuffer(sizeof(*Frame->StagingData) * vkChunkTiles * vkChunkTiles * vkChunkUploads,
+			&Frame->Staging, &Frame->StagingMemory);
+
+		Result = vkMapMemory(vkDevice, Frame->StagingMemory, 0, VK_WHOLE_SIZE, 0, (void**) &Frame->StagingData);
+		AssertEQ(Result, VK_SUCCESS);
+	}
+	while(++Frame != vkFrameEnd);
+}
+
+
+static void
+VulkanDestroyObjects(
+	void
+	)
+{
+	VkFrame* Frame = vkFrames;
+
+	do
+	{
+		VkFence* Fence = Frame->Fences;
+		VkFence* FenceEnd = Frame->Fences + ARRAYLEN(Frame->Fences);
+
+		do
+		{
+			vkDestroyFence(vkDevice, *Fence, NULL);
+		}
+		while(++Fence != FenceEnd);
+
+
+		VkSemaphore* Semaphore = Frame->Semaphores;
+		VkSemaphore* SemaphoreEnd = Frame->Semaphores + ARRAYLEN(Frame->Semaphores);
+
+		do
+		{
+			vkDestroySemaphore(vkDevice, *Semaphore, NULL);
+		}
+		while(++Semaphore != SemaphoreEnd);
+
+
+		vkUnmapMemory(vkDevice, Frame->ConstantMemory);
+		vkFreeMemory(vkDevice, Frame->ConstantMemory, NULL);
+		vkDestroyBuffer(vkDevice, Frame->Constants, NULL);
+
+		vkUnmapMemory(vkDevice, Frame->InstanceMemory);
+		vkFreeMemory(vkDevice, Frame->InstanceMemory, NULL);
+		vkDestroyBuffer(vkDevice, Frame->Instances, NULL);
+
+		vkUnmapMemory(vkDevice, Frame->StagingMemory);
+		vkFreeMemory(vkDevice, Frame->StagingMemory, NULL);
+		vkDestroyBuffer(vkDevice, Frame->Staging, NULL);
+	}
+	while(++Frame != vkFrameEnd);
+}
+
+
+static void
+VulkanInitVertex(
+	void
+	)
+{
+	VulkanUploadFinalBuffer(vkVertexVertexInput, sizeof(vkVertexVertexInput), 1,
+		&vkVertexVertexInputBuffer, &vkVertexVertexInputMemory);
+}
+
+
+static void
+VulkanDestroyVertex(
+	void
+	)
+{
+	vkFreeMemory(vkDevice, vkVertexVertexInputMemory, NULL);
+	vkDestroyBuffer(vkDevice, vkVertexVertexInputBuffer, NULL);
+}
+
+
+#ifdef __linux__
+
+static int vkReloadFD = -1;
+static int vkReloadShaders;
+static int vkReloadTextures;
+static int vkReloadStop;
+static pthread_t vkReloadThread;
+static pthread_mutex_t vkReloadMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static VkPipeline vkReloadPipelines[kPIPELINE];
+static Pixels vkReloadPixels[ARRAYLEN(vkTexturePaths)];
+
+
+/*
+ * Rebuilds whatever changed on disk off the frame loop. The results are only
+ * swapped in by VulkanApplyReload() at a frame boundary.
+ */
+static void*
+VulkanReload(
+	void* Data
+	)
+{
+	char Buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	while(!__atomic_load_n(&vkReloadStop, __ATOMIC_ACQUIRE))
+	{
+		struct pollfd Poll = {0};
+		Poll.fd = vkReloadFD;
+		Poll.events = POLLIN;
+
+		if(poll(&Poll, 1, 100) <= 0)
+		{
+			continue;
+		}
+
+		ssize_t Length = read(vkReloadFD, Buffer, sizeof(Buffer));
+		if(Length <= 0)
+		{
+			continue;
+		}
+
+		int Shaders = 0;
+		uint32_t Textures = 0;
+
+		char* Event = Buffer;
+		char* EventEnd = Buffer + Length;
+
+		while(Event < EventEnd)
+		{
+			struct inotify_event* Info = (struct inotify_event*) Event;
+			Event += sizeof(*Info) + Info->len;
+
+			if(Info->len == 0)
+			{
+				continue;
+			}
+
+			if(Info->wd == vkReloadShaders)
+			{
+				size_t NameLength = strlen(Info->name);
+				Shaders |= NameLength > 4 && strcmp(Info->name + NameLength - 4, ".spv") == 0;
+			}
+			else if(Info->wd == vkReloadTextures)
+			{
+				for(uint32_t i = 0; i < ARRAYLEN(vkTexturePaths); ++i)
+				{
+					if(strcmp(Info->name, strrchr(vkTexturePaths[i], '/') + 1) == 0)
+					{
+						Textures |= 1u << i;
+					}
+				}
+			}
+		}
+
+		if(Shaders)
+		{
+			/*
+			 * The pipeline depends on the render pass and sample state, so it
+			 * is built under the lock VulkanSetQuality() holds while swapping them.
+			 */
+			pthread_mutex_lock(&vkReloadMutex);
+
+			VkPipeline Pipelines[kPIPELINE];
+
+			if(VulkanTryCreateGraphicsPipelines(Pipelines) == -1)
+			{
+				printf("shader reload failed, keeping the current pipelines\n");
+			}
+			else
+			{
+				if(vkReloadPipelines[0] != VK_NULL_HANDLE)
+				{
+					VulkanDestroyGraphicsPipelines(vkReloadPipelines);
+				}
+
+				memcpy(vkReloadPipelines, Pipelines, sizeof(Pipelines));
+			}
+
+			pthread_mutex_unlock(&vkReloadMutex);
+		}
+
+		for(uint32_t i = 0; i < ARRAYLEN(vkTexturePaths); ++i)
+		{
+			if(!(Textures & (1u << i)))
+			{
+				continue;
+			}
+
+			Pixels Pixels;
+
+			if(VulkanTryLoadPixels(vkTexturePaths[i], &Pixels) == -1)
+			{
+				printf("%s reload failed, keeping the current texture\n", vkTexturePaths[i]);
+				continue;
+			}
+
+			pthread_mutex_lock(&vkReloadMutex);
+
+			if(vkReloadPixels[i].Data != NULL)
+			{
+				VulkanFreePixels(vkReloadPixels + i);
+			}
+
+			vkReloadPixels[i] = Pixels;
+
+			pthread_mutex_unlock(&vkReloadMutex);
+		}
+	}
+
+	return NULL;
+}
+
+
+static void
+VulkanInitReload(
+	void
+	)
+{
+	/* A regression run renders only what it was started with */
+	if(vkChecking)
+	{
+		return;
+	}
+
+	vkReloadFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(vkReloadFD == -1)
+	{
+		return;
+	}
+
+	vkReloadShaders = inotify_add_watch(vkReloadFD, "bin", IN_CLOSE_WRITE | IN_MOVED_TO);
+	vkReloadTextures = inotify_add_watch(vkReloadFD, "textures", IN_CLOSE_WRITE | IN_MOVED_TO);
+
+	int Error = pthread_create(&vkReloadThread, NULL, VulkanReload, NULL);
+	AssertEQ(Error, 0);
+}
+
+
+static void
+VulkanDestroyReload(
+	void
+	)
+{
+	if(vkReloadFD == -1)
+	{
+		return;
+	}
+
+	__atomic_store_n(&vkReloadStop, 1, __ATOMIC_RELEASE);
+
+	int Error = pthread_join(vkReloadThread, NULL);
+	AssertEQ(Error, 0);
+
+	close(vkReloadFD);
+
+	if(vkReloadPipelines[0] != VK_NULL_HANDLE)
+	{
+		VulkanDestroyGraphicsPipelines(vkReloadPipelines);
+	}
+
+	for(uint32_t i = 0; i < ARRAYLEN(vkReloadPixels); ++i)
+	{
+		if(vkReloadPixels[i].Data != NULL)
+		{
+			VulkanFreePixels(vkReloadPixels + i);
+		}
+	}
+}
+
+
+static void
+VulkanApplyReload(
+	void
+	)
+{
+	if(vkReloadFD == -1)
+	{
+		return;
+	}
+
+	if(pthread_mutex_trylock(&vkReloadMutex) != 0)
+	{
+		return;
+	}
+
+	VkPipeline Pipelines[kPIPELINE];
+	memcpy(Pipelines, vkReloadPipelines, sizeof(vkReloadPipelines));
+	memset(vkReloadPipelines, 0, sizeof(vkReloadPipelines));
+
+	Pixels Pixels[ARRAYLEN(vkReloadPixels)];
+	memcpy(Pixels, vkReloadPixels, sizeof(vkReloadPixels));
+
+	for(uint32_t i = 0; i < ARRAYLEN(vkReloadPixels); ++i)
+	{
+		vkReloadPixels[i].Data = NULL;
+	}
+
+	pthread_mutex_unlock(&vkReloadMutex);
+
+	if(Pipelines[0] != VK_NULL_HANDLE)
+	{
+		VulkanRetirePipelines(vkPipelines);
+		memcpy(vkPipelines, Pipelines, sizeof(Pipelines));
+	}
+
+	int Stale = 0;
+
+	for(uint32_t i = 0; i < ARRAYLEN(Pixels); ++i)
+	{
+		if(Pixels[i].Data == NULL)
+		{
+			continue;
+		}
+
+		if(i == 0)
+		{
+			VulkanRetireImage(&vkPalette);
+			VulkanRetireImage(&vkIndexedTexture);
+		}
+		else
+		{
+			VulkanRetireImage(vkTextures + i);
+		}
+
+		VulkanCreateTextures(Pixels + i, i);
+		VulkanFreePixels(Pixels + i);
+
+		Stale = 1;
+	}
+
+	if(Stale)
+	{
+		VkFrame* Frame = vkFrames;
+
+		do
+		{
+			Frame->StaleDescriptors = 1;
+		}
+		while(++Frame != vkFrameEnd);
+	}
+}
+
+
+static void
+VulkanPauseReload(
+	void
+	)
+{
+	if(vkReloadFD == -1)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&vkReloadMutex);
+
+	if(vkReloadPipelines[0] != VK_NULL_HANDLE)
+	{
+		VulkanDestroyGraphicsPipelines(vkReloadPipelines);
+		memset(vkReloadPipelines, 0, sizeof(vkReloadPipelines));
+	}
+}
+
+
+static void
+VulkanResumeReload(
+	void
+	)
+{
+	if(vkReloadFD == -1)
+	{
+		return;
+	}
+
+	pthread_mutex_unlock(&vkReloadMutex);
+}
+
+#else
+
+static void
+VulkanInitReload(
+	void
+	)
+{
+}
+
+
+static void
+VulkanDestroyReload(
+	void
+	)
+{
+}
+
+
+static void
+VulkanApplyReload(
+	void
+	)
+{
+}
+
+
+static void
+VulkanPauseReload(
+	void
+	)
+{
+}
+
+
+static void
+VulkanResumeReload(
+	void
+	)
+{
+}
+
+#endif /* __linux__ */
+
+
+/*
+ * Everything that depends on the sample count or on where the scene is
+ * rendered to goes through the retire queue, so frames in flight keep
+ * rendering with the old objects.
+ */
+static void
+VulkanRetireTargets(
+	void
+	)
+{
+	VulkanRetirePipelines(vkPipelines);
+	VulkanRetireFramebuffers(vkFramebuffers);
+	VulkanRetireRenderPass(vkRenderPass);
+	VulkanRetireImage(&vkOffscreen);
+
+	for(uint32_t i = 0; i < vkGraph.ImageCount; ++i)
+	{
+		Image Attachment = VulkanGetAttachment(i);
+		VulkanRetireImage(&Attachment);
+	}
+
+	GraphReleaseImages(&vkGraph);
+}
+
+
+static void
+VulkanCreateTargets(
+	void
+	)
+{
+	VulkanInitAttachments();
+	VulkanInitOffscreen();
+	VulkanInitRenderPass();
+	VulkanInitFramebuffers();
+
+	VulkanCreateGraphicsPipelines(vkPipelines);
+}
+
+
+static int
+VulkanQualitySupported(
+	uint32_t Quality
+	)
+{
+	const QualityTier* Tier = vkQualities + Quality;
+
+	if(!(vkSampleCounts & Tier->Samples))
+	{
+		return 0;
+	}
+
+	if(Tier->SampleShading && !vkSampleShadingSupported)
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+
+static void
+VulkanSetQuality(
+	uint32_t Quality
+	)
+{
+	AssertEQ(VulkanQualitySupported(Quality), 1);
+
+	if(Quality == vkQuality)
+	{
+		return;
+	}
+
+	VulkanPauseReload();
+	VulkanRetireTargets();
+
+	vkQuality = Quality;
+	vkSamples = vkQualities[Quality].Samples;
+	vkSampleShading = vkQualities[Quality].SampleShading;
+
+	VulkanCreateTargets();
+	VulkanResumeReload();
+}
+
+
+static void
+VulkanStepQuality(
+	void
+	)
+{
+	uint32_t Quality = vkQuality;
+
+	do
+	{
+		Quality = (Quality + 1) % ARRAYLEN(vkQualities);
+	}
+	while(!VulkanQualitySupported(Quality));
+
+	VulkanSetQuality(Quality);
+
+	printf("quality %s\n", vkQualities[vkQuality].Name);
+}
+
+
+/*
+ * The closest supported tier above or below the current one, or the current
+ * one when there is none in that direction.
+ */
+static uint32_t
+VulkanGetNextQuality(
+	int Up
+	)
+{
+	for(uint32_t Quality = vkQuality; Up ? Quality + 1 < ARRAYLEN(vkQualities) : Quality > 0;)
+	{
+		Quality = Up ? Quality + 1 : Quality - 1;
+
+		if(VulkanQualitySupported(Quality))
+		{
+			return Quality;
+		}
+	}
+
+	return vkQuality;
+}
+
+
+static VkExtent2D
+VulkanGetRenderExtent(
+	void
+	)
+{
+	if(!vkScaling)
+	{
+		return vkExtent;
+	}
+
+	return (VkExtent2D)
+	{
+		.width = MAX(vkExtent.width * vkScale / vkScaleSteps, 1),
+		.height = MAX(vkExtent.height * vkScale / vkScaleSteps, 1)
+	};
+}
+
+
+/*
+ * The scene is rendered into the top left corner of an offscreen target that
+ * is as large as the swapchain, so changing the scale only moves the
+ * viewport set in VulkanRecordCommands().
+ */
+static void
+VulkanSetScale(
+	uint32_t Scale
+	)
+{
+	vkScale = Scale;
+	vkRenderExtent = VulkanGetRenderExtent();
+	vkScaleWait = vkScaleCooldown;
+}
+
+
+static void
+VulkanSetScaling(
+	int Scaling
+	)
+{
+	if(!vkScalingSupported || Scaling == vkScaling)
+	{
+		return;
+	}
+
+	VulkanPauseReload();
+	VulkanRetireTargets();
+
+	vkScaling = Scaling;
+	vkScale = vkScaleSteps;
+	vkScaleWait = vkScaleCooldown;
+	vkRenderExtent = VulkanGetRenderExtent();
+
+	VulkanCreateTargets();
+	VulkanResumeReload();
+
+	printf("dynamic resolution %s\n", vkScaling ? "on" : "off");
+}
+
+
+/*
+ * Steps the scale down when the smoothed GPU time gets close to a refresh
+ * interval and back up once there is plenty of headroom. Past either end of
+ * the scale it steps the quality tier instead, and never climbs back to a
+ * tier it had to leave. Each step waits for the average to settle.
+ */
+static void
+VulkanUpdateScale(
+	double Time
+	)
+{
+	vkFrameTime = vkFrameTime * 0.9 + Time * 0.1;
+
+	if(!vkScaling || vkChecking || vkReplaying)
+	{
+		return;
+	}
+
+	if(vkScaleWait != 0)
+	{
+		--vkScaleWait;
+		return;
+	}
+
+	double Budget = 1.0 / (vkRefreshRate > 0 ? vkRefreshRate : 60);
+
+	if(vkFrameTime > Budget * 0.9)
+	{
+		uint32_t Lower = VulkanGetNextQuality(0);
+
+		if(vkScale > vkScaleMin)
+		{
+			VulkanSetScale(vkScale - 1);
+		}
+		else if(Lower != vkQuality)
+		{
+			vkQualityCeiling = vkQuality;
+			VulkanSetQuality(Lower);
+		}
+	}
+	else if(vkFrameTime < Budget * 0.6)
+	{
+		uint32_t Higher = VulkanGetNextQuality(1);
+
+		if(vkScale < vkScaleSteps)
+		{
+			VulkanSetScale(vkScale + 1);
+		}
+		else if(Higher != vkQuality && Higher < vkQualityCeiling)
+		{
+			VulkanSetQuality(Higher);
+		}
+	}
+}
+
+
+static void
+VulkanReadFrameTime(
+	void
+	)
+{
+	if(!vkFrame->Timed)
+	{
+		return;
+	}
+
+	vkFrame->Timed = 0;
+
+	uint64_t Stamps[2];
+	uint32_t Query = (vkFrame - vkFrames) * 2;
+
+	VkResult Result = vkGetQueryPoolResults(vkDevice, vkQueryPool, Query, 2,
+		sizeof(Stamps), Stamps, sizeof(*Stamps), VK_QUERY_RESULT_64_BIT);
+
+	if(Result != VK_SUCCESS)
+	{
+		return;
+	}
+
+	uint64_t Mask = vkTimestampBits < 64 ? (UINT64_C(1) << vkTimestampBits) - 1 : UINT64_MAX;
+	uint64_t Ticks = (Stamps[1] - Stamps[0]) & Mask;
+
+	VulkanUpdateScale(Ticks * (double) vkLimits.timestampPeriod / 1000000000.0);
+}
+
+
+static void
+VulkanReadStatistics(
+	void
+	)
+{
+	if(!vkFrame->Counted)
+	{
+		return;
+	}
+
+	vkFrame->Counted = 0;
+
+	uint64_t Statistics[ARRAYLEN(vkStatistics)];
+
+	VkResult Result = vkGetQueryPoolResults(vkDevice, vkStatisticsPool, vkFrame - vkFrames, 1,
+		sizeof(Statistics), Statistics, sizeof(Statistics), VK_QUERY_RESULT_64_BIT);
+
+	if(Result == VK_SUCCESS)
+	{
+		memcpy(vkStatistics, Statistics, sizeof(Statistics));
+	}
+}
+
+
+static void
+VulkanPushSprite(
+	const Sprite* Item
+	)
+{
+	AssertEQ(Item->Instance.Texture < ARRAYLEN(vkTexturePaths), 1);
+	AssertEQ(Item->Blend < kBLEND, 1);
+
+	if(vkSpriteCount == vkSpriteSize)
+	{
+		vkSprites = GrowArray(vkSprites, &vkSpriteSize, vkSpriteCount, sizeof(*vkSprites));
+
+		/* The second half of both sort arrays is scratch space for RadixSort() */
+		vkSortKeys = realloc(vkSortKeys, sizeof(*vkSortKeys) * vkSpriteSize * 2);
+		AssertNEQ(vkSortKeys, NULL);
+
+		vkSortValues = realloc(vkSortValues, sizeof(*vkSortValues) * vkSpriteSize * 2);
+		AssertNEQ(vkSortValues, NULL);
+
+		vkBatches = realloc(vkBatches, sizeof(*vkBatches) * vkSpriteSize);
+		AssertNEQ(vkBatches, NULL);
+	}
+
+	vkSprites[vkSpriteCount++] = *Item;
+}
+
+
+/*
+ * From the most significant bits down: layer, pipeline, descriptor set and
+ * depth. Depth is the float bit pattern made to sort as an unsigned integer,
+ * so sprites within a batch go back to front.
+ */
+static uint64_t
+VulkanGetSortKey(
+	const Sprite* Item
+	)
+{
+	uint32_t Depth;
+	memcpy(&Depth, &Item->Instance.Position[2], sizeof(Depth));
+	Depth ^= (Depth >> 31) ? UINT32_MAX : UINT32_C(0x80000000);
+
+	uint64_t Descriptor = vkBindless ? 0 : Item->Instance.Texture;
+
+	return
+		((uint64_t) Item->Layer << 56) |
+		((uint64_t) (Item->Blend & 0xF) << 52) |
+		((Descriptor & 0xFFF) << 40) |
+		((uint64_t) Depth << 8);
+}
+
+
+/*
+ * Sorts the sprites pushed this frame into the frame's instance buffer and
+ * merges neighbours that share state into batches.
+ */
+static void
+VulkanBuildDrawList(
+	void
+	)
+{
+	uint32_t Count = vkSpriteCount;
+
+	VulkanGrowFrameInstances(Count);
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		vkSortKeys[i] = VulkanGetSortKey(vkSprites + i);
+		vkSortValues[i] = i;
+	}
+
+	RadixSort(vkSortKeys, vkSortValues, vkSortKeys + vkSpriteSize, vkSortValues + vkSpriteSize, Count);
+
+	vkBatchCount = 0;
+	Batch* Last = NULL;
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		const Sprite* Item = vkSprites + vkSortValues[i];
+		uint32_t Descriptor = vkBindless ? 0 : Item->Instance.Texture;
+
+		vkFrame->InstanceData[i] = Item->Instance;
+
+		if(Last != NULL && Last->Blend == Item->Blend && Last->Descriptor == Descriptor)
+		{
+			++Last->Count;
+			continue;
+		}
+
+		Last = vkBatches + vkBatchCount++;
+		Last->Blend = Item->Blend;
+		Last->Descriptor = Descriptor;
+		Last->First = i;
+		Last->Count = 1;
+	}
+
+	vkSpriteCount = 0;
+}
+
+
+static void
+VulkanFreeDrawList(
+	void
+	)
+{
+	free(vkBatches);
+	free(vkSortValues);
+	free(vkSortKeys);
+	free(vkSprites);
+}
+
+
+static void
+VulkanApplyTransforms(
+	int Insert
+	)
+{
+	uint32_t Count = TransformsUpdate(&vkTransforms);
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		uint32_t Index = vkTransforms.Updated[i];
+		VkVertexInstanceInput* Instance = &vkScene[Index].Instance;
+
+		Instance->Position[0] = vkTransforms.WorldX[Index];
+		Instance->Position[1] = vkTransforms.WorldY[Index];
+		Instance->Rotation = vkTransforms.WorldRotation[Index];
+
+		if(Insert)
+		{
+			/* Bounds of the quad under any rotation */
+			float Radius = 0.5f * sqrtf(
+				Instance->Dimensions[0] * Instance->Dimensions[0] +
+				Instance->Dimensions[1] * Instance->Dimensions[1]);
+
+			GridInsert(&vkGrid, Index, Instance->Position[0], Instance->Position[1], Radius, Radius);
+		}
+		else
+		{
+			GridMove(&vkGrid, Index, Instance->Position[0], Instance->Position[1]);
+		}
+	}
+}
+
+
+static void
+VulkanInitScene(
+	void
+	)
+{
+	GridInit(&vkGrid, vkGridSpacing);
+	TransformsInit(&vkTransforms);
+
+	/* Hang the last sprite off the one before it so it orbits its parent */
+	uint32_t Child = ARRAYLEN(vkScene) - 1;
+
+	for(uint32_t i = 0; i < ARRAYLEN(vkScene); ++i)
+	{
+		Sprite* Item = vkScene + i;
+		Item->Instance = vkVertexInstanceInput[i];
+		Item->Layer = 0;
+		Item->Blend = BLEND_ALPHA;
+
+		if(i == Child)
+		{
+			TransformAdd(&vkTransforms, Child - 1, 0.75f, 0.0f,
+				Item->Instance.Rotation - vkScene[Child - 1].Instance.Rotation);
+		}
+		else
+		{
+			TransformAdd(&vkTransforms, TRANSFORM_ROOT, Item->Instance.Position[0],
+				Item->Instance.Position[1], Item->Instance.Rotation);
+		}
+	}
+
+	VulkanApplyTransforms(1);
+}
+
+
+static void
+VulkanDestroyScene(
+	void
+	)
+{
+	TransformsFree(&vkTransforms);
+	GridFree(&vkGrid);
+}
+
+
+static void
+VulkanMoveSprite(
+	uint32_t ID,
+	float X,
+	float Y,
+	float Rotation
+	)
+{
+	TransformSet(&vkTransforms, ID, X, Y, Rotation);
+
+	if(vkLogging)
+	{
+		RecordSetSprite(&vkLog, ID, X, Y, Rotation);
+	}
+}
+
+
+static void
+VulkanUpdateScene(
+	void
+	)
+{
+	if(vkReplaying)
+	{
+		for(uint32_t i = 0; i < vkLog.Frame.SpriteCount; ++i)
+		{
+			const RecordSprite* Sprite = vkLog.Sprites + i;
+
+			if(Sprite->ID < vkTransforms.Count)
+			{
+				TransformSet(&vkTransforms, Sprite->ID, Sprite->X, Sprite->Y, Sprite->Rotation);
+			}
+		}
+
+		VulkanApplyTransforms(0);
+		return;
+	}
+
+	vkRotation += 0.0001;
+
+	uint32_t Parent = ARRAYLEN(vkScene) - 2;
+	const VkVertexInstanceInput* Instance = vkVertexInstanceInput + Parent;
+
+	VulkanMoveSprite(Parent, Instance->Position[0], Instance->Position[1], Instance->Rotation + vkRotation);
+
+	VulkanApplyTransforms(0);
+}
+
+
+/*
+ * Lays Text out from X, Y in world units and pushes one instance per
+ * glyph. Nothing is drawn when no font could be loaded.
+ */
+static void
+VulkanDrawText(
+	const char* Text,
+	float X,
+	float Y,
+	float Z,
+	float Height,
+	uint32_t Color
+	)
+{
+	if(!vkFontLoaded)
+	{
+		return;
+	}
+
+	FontQuad Quads[256];
+	uint32_t Count = MIN(FontLayout(&vkFont, Text, X, Y, Height, Quads, ARRAYLEN(Quads)), ARRAYLEN(Quads));
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		Sprite Item = {0};
+		Item.Instance.Position[0] = Quads[i].X;
+		Item.Instance.Position[1] = Quads[i].Y;
+		Item.Instance.Position[2] = Z;
+		Item.Instance.Dimensions[0] = Quads[i].Size;
+		Item.Instance.Dimensions[1] = Quads[i].Size;
+		Item.Instance.TexIndex = Quads[i].Glyph;
+		Item.Instance.Color = Color;
+		Item.Instance.Flags = INSTANCE_SDF;
+		Item.Layer = 0;
+		Item.Blend = BLEND_ALPHA;
+
+		VulkanPushSprite(&Item);
+	}
+}
+
+
+static void
+VulkanDrawScene(
+	void
+	)
+{
+	GridCells Cells;
+	GridBeginCells(&vkGrid, vkView[0], vkView[1], vkView[2], vkView[3], &Cells);
+
+	const GridCell* Cell;
+
+	while((Cell = GridNextCell(&Cells)) != NULL)
+	{
+		const GridEntry* Entry = Cell->Entries;
+		const GridEntry* EntryEnd = Cell->Entries + Cell->Count;
+
+		for(; Entry != EntryEnd; ++Entry)
+		{
+			if(GridOverlaps(Entry, vkView[0], vkView[1], vkView[2], vkView[3]))
+			{
+				VulkanPushSprite(vkScene + Entry->ID);
+			}
+		}
+	}
+
+	/* The timing labels differ from run to run */
+	if(vkChecking)
+	{
+		return;
+	}
+
+	char Label[64];
+	snprintf(Label, sizeof(Label), "GPU %.2f ms", vkFrameTime * 1000.0);
+
+	VulkanDrawText(Label, -1.5f, -1.2f, 1.5f, 0.2f, UINT32_MAX);
+
+	if(!vkStatisticsSupported)
+	{
+		return;
+	}
+
+	/* Fragments per pixel of the render area, so overdraw times shaded samples */
+	double Overdraw = (double) vkStatistics[2] / ((double) vkRenderExtent.width * vkRenderExtent.height);
+
+	snprintf(Label, sizeof(Label), "VS %llu CP %llu FS %llu %.1fx",
+		(unsigned long long) vkStatistics[0], (unsigned long long) vkStatistics[1],
+		(unsigned long long) vkStatistics[2], Overdraw);
+
+	VulkanDrawText(Label, -1.5f, -1.0f, 1.5f, 0.2f, UINT32_MAX);
+}
+
+
+static void
+VulkanSetTile(
+	uint32_t X,
+	uint32_t Y,
+	uint16_t Tile
+	)
+{
+	uint32_t Index = (Y / vkChunkTiles) * vkChunksX + X / vkChunkTiles;
+	TileChunk* Chunk = vkChunks + Index;
+
+	Chunk->Tiles[(Y % vkChunkTiles) * vkChunkTiles + X % vkChunkTiles] = Tile;
+
+	if(!Chunk->Dirty)
+	{
+		Chunk->Dirty = 1;
+		vkDirtyChunks[vkDirtyChunkCount++] = Index;
+	}
+}
+
+
+static void
+VulkanInitTilemap(
+	uint32_t Width,
+	uint32_t Height
+	)
+{
+	vkChunksX = (Width + vkChunkTiles - 1) / vkChunkTiles;
+	vkChunksY = (Height + vkChunkTiles - 1) / vkChunkTiles;
+
+	uint32_t Count = vkChunksX * vkChunksY;
+
+	vkChunks = calloc(Count, sizeof(*vkChunks));
+	AssertNEQ(vkChunks, NULL);
+
+	vkDirtyChunks = malloc(sizeof(*vkDirtyChunks) * Count);
+	AssertNEQ(vkDirtyChunks, NULL);
+
+	VulkanGetFinalBuffer(sizeof(VkVertexInstanceInput) * vkChunkTiles * vkChunkTiles * Count,
+		&vkTileBuffer, &vkTileMemory);
+
+	vkTileInstanceSet = VulkanCreateInstanceSet(vkTileBuffer);
+
+	for(uint32_t Y = 0; Y < Height; ++Y)
+	{
+		for(uint32_t X = 0; X < Width; ++X)
+		{
+			if((X * 7 + Y * 13) % 11 != 0)
+			{
+				VulkanSetTile(X, Y, 1 + ((X ^ Y) & 3));
+			}
+		}
+	}
+}
+
+
+static void
+VulkanDestroyTilemap(
+	void
+	)
+{
+	vkFreeMemory(vkDevice, vkTileMemory, NULL);
+	vkDestroyBuffer(vkDevice, vkTileBuffer, NULL);
+
+	free(vkDirtyChunks);
+	free(vkChunks);
+}
+
+
+/*
+ * Rebuilds the instances of a few dirty chunks in the frame's staging
+ * buffer and records their copies ahead of the render pass.
+ */
+static void
+VulkanRecordTileUploads(
+	VkCommandBuffer CommandBuffer,
+	void* Data
+	)
+{
+	uint32_t Count = MIN(vkDirtyChunkCount, vkChunkUploads);
+
+	VkBufferCopy Copies[vkChunkUploads];
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		uint32_t Index = vkDirtyChunks[i];
+		TileChunk* Chunk = vkChunks + Index;
+
+		float OriginX = vkTileOrigin[0] + (Index % vkChunksX) * vkChunkTiles * vkTileSize;
+		float OriginY = vkTileOrigin[1] + (Index / vkChunksX) * vkChunkTiles * vkTileSize;
+
+		VkVertexInstanceInput* Instance = vkFrame->StagingData + i * vkChunkTiles * vkChunkTiles;
+		VkVertexInstanceInput* InstanceStart = Instance;
+
+		for(uint32_t Tile = 0; Tile < vkChunkTiles * vkChunkTiles; ++Tile)
+		{
+			if(Chunk->Tiles[Tile] == 0)
+			{
+				continue;
+			}
+
+			*Instance = (VkVertexInstanceInput){0};
+			Instance->Position[0] = OriginX + (Tile % vkChunkTiles + 0.5f) * vkTileSize;
+			Instance->Position[1] = OriginY + (Tile / vkChunkTiles + 0.5f) * vkTileSize;
+			Instance->Position[2] = vkTileDepth;
+			Instance->Dimensions[0] = vkTileSize;
+			Instance->Dimensions[1] = vkTileSize;
+			Instance->TexIndex = Chunk->Tiles[Tile] - 1;
+			Instance->Texture = vkTileSheet;
+			Instance->Color = UINT32_MAX;
+
+			++Instance;
+		}
+
+		Chunk->Count = Instance - InstanceStart;
+		Chunk->Dirty = 0;
+
+		Copies[i].srcOffset = sizeof(*Instance) * (InstanceStart - vkFrame->StagingData);
+		Copies[i].dstOffset = sizeof(*Instance) * vkChunkTiles * vkChunkTiles * Index;
+		Copies[i].size = MAX(sizeof(*Instance) * Chunk->Count, sizeof(*Instance));
+	}
+
+	vkDirtyChunkCount -= Count;
+	memmove(vkDirtyChunks, vkDirtyChunks + Count, sizeof(*vkDirtyChunks) * vkDirtyChunkCount);
+
+	vkCmdCopyBuffer(CommandBuffer, vkFrame->Staging, vkTileBuffer, Count, Copies);
+}
+
+
+/*
+ * The chunks overlapping the view as an inclusive MinX, MinY, MaxX, MaxY
+ * range. The range comes straight from the view rectangle, so the cost does
+ * not depend on the map size. Returns 0 when no chunk is visible.
+ */
+static int
+VulkanGetVisibleChunks(
+	int32_t* Range
+	)
+{
+	float ChunkSize = vkChunkTiles * vkTileSize;
+
+	Range[0] = (int32_t) floorf((vkView[0] - vkTileOrigin[0]) / ChunkSize);
+	Range[1] = (int32_t) floorf((vkView[1] - vkTileOrigin[1]) / ChunkSize);
+	Range[2] = (int32_t) floorf((vkView[2] - vkTileOrigin[0]) / ChunkSize);
+	Range[3] = (int32_t) floorf((vkView[3] - vkTileOrigin[1]) / ChunkSize);
+
+	Range[0] = MAX(Range[0], 0);
+	Range[1] = MAX(Range[1], 0);
+	Range[2] = MIN(Range[2], (int32_t) vkChunksX - 1);
+	Range[3] = MIN(Range[3], (int32_t) vkChunksY - 1);
+
+	return Range[0] <= Range[2] && Range[1] <= Range[3];
+}
+
+
+/*
+ * Draws every chunk overlapping the view with the tile count it has now.
+ */
+static void
+VulkanRecordTilemap(
+	void
+	)
+{
+	int32_t Range[4];
+
+	if(!VulkanGetVisibleChunks(Range))
+	{
+		return;
+	}
+
+	vkCmdBindPipeline(vkFrame->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, VulkanGetPipeline(BLEND_ALPHA));
+	vkCmdBindDescriptorSets(vkFrame->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+		vkPipelineLayout, 0, 1, vkFrame->DescriptorSets + (vkBindless ? 0 : vkTileSheet), 0, NULL);
+
+	VulkanBindInstances(vkTileBuffer, vkTileInstanceSet);
+
+	for(int32_t Y = Range[1]; Y <= Range[3]; ++Y)
+	{
+		for(int32_t X = Range[0]; X <= Range[2]; ++X)
+		{
+			uint32_t Index = Y * vkChunksX + X;
+			uint32_t Count = vkChunks[Index].Count;
+
+			if(Count != 0)
+			{
+				vkCmdDraw(vkFrame->CommandBuffer, ARRAYLEN(vkVertexVertexInput), Count,
+					0, Index * vkChunkTiles * vkChunkTiles);
+			}
+		}
+	}
+
+	VulkanBindInstances(vkFrame->Instances, vkFrame->InstanceSet);
+}
+
+
+static double
+VulkanTime(
+	void
+	)
+{
+	struct timespec Time = {0};
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+
+	return Time.tv_sec + Time.tv_nsec / 1000000000.0;
+}
+
+
+static void
+VulkanInitParticles(
+	void
+	)
+{
+	VulkanGetBuffer(sizeof(VkParticle) * vkParticleCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&vkParticleBuffer, &vkParticleMemory);
+
+	VulkanGetBuffer(sizeof(VkVertexInstanceInput) * vkParticleCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&vkParticleInstances, &vkParticleInstanceMemory);
+
+	VulkanGetBuffer(sizeof(VkDrawIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vkParticleIndirect, &vkParticleIndirectMemory);
+
+
+	VkDescriptorSetLayoutBinding Bindings[4] = {0};
+
+	for(uint32_t i = 0; i < ARRAYLEN(Bindings); ++i)
+	{
+		Bindings[i].binding = i;
+		Bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		Bindings[i].descriptorCount = 1;
+		Bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		Bindings[i].pImmutableSamplers = NULL;
+	}
+
+	VkDescriptorSetLayoutCreateInfo Descriptors = {0};
+	Descriptors.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	Descriptors.pNext = NULL;
+	Descriptors.flags = 0;
+	Descriptors.bindingCount = ARRAYLEN(Bindings);
+	Descriptors.pBindings = Bindings;
+
+	VkResult Result = vkCreateDescriptorSetLayout(vkDevice, &Descriptors, NULL, &vkParticleDescriptors);
+	AssertEQ(Result, VK_SUCCESS);
+
+	/* One set per frame, only the constants binding differs between them */
+	uint32_t Sets = vkFrameEnd - vkFrames;
+
+	VkDescriptorPoolSize PoolSizes[1] = {0};
+
+	PoolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	PoolSizes[0].descriptorCount = ARRAYLEN(Bindings) * Sets;
+
+	VkDescriptorPoolCreateInfo DescriptorInfo = {0};
+	DescriptorInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	DescriptorInfo.pNext = NULL;
+	DescriptorInfo.flags = 0;
+	DescriptorInfo.maxSets = Sets;
+	DescriptorInfo.poolSizeCount = ARRAYLEN(PoolSizes);
+	DescriptorInfo.pPoolSizes = PoolSizes;
+
+	Result = vkCreateDescriptorPool(vkDevice, &DescriptorInfo, NULL, &vkParticleDescriptorPool);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VkDescriptorSetAllocateInfo AllocInfo = {0};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	AllocInfo.pNext = NULL;
+	AllocInfo.descriptorPool = vkParticleDescriptorPool;
+	AllocInfo.descriptorSetCount = 1;
+	AllocInfo.pSetLayouts = &vkParticleDescriptors;
+
+	VkDescriptorBufferInfo BufferInfos[4] = {0};
+
+	BufferInfos[0].buffer = vkParticleBuffer;
+	BufferInfos[0].offset = 0;
+	BufferInfos[0].range = VK_WHOLE_SIZE;
+
+	BufferInfos[1].buffer = vkParticleInstances;
+	BufferInfos[1].offset = 0;
+	BufferInfos[1].range = VK_WHOLE_SIZE;
+
+	BufferInfos[2].buffer = vkParticleIndirect;
+	BufferInfos[2].offset = 0;
+	BufferInfos[2].range = VK_WHOLE_SIZE;
+
+	BufferInfos[3].offset = offsetof(VkFrameConstantInput, Particles);
+	BufferInfos[3].range = sizeof(VkParticleConstantInput);
+
+	VkFrame* Frame = vkFrames;
+
+	do
+	{
+		Result = vkAllocateDescriptorSets(vkDevice, &AllocInfo, &Frame->ParticleSet);
+		AssertEQ(Result, VK_SUCCESS);
+
+		BufferInfos[3].buffer = Frame->Constants;
+
+		VkWriteDescriptorSet DescriptorWrite = {0};
+		DescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		DescriptorWrite.pNext = NULL;
+		DescriptorWrite.dstSet = Frame->ParticleSet;
+		DescriptorWrite.dstBinding = 0;
+		DescriptorWrite.dstArrayElement = 0;
+		DescriptorWrite.descriptorCount = ARRAYLEN(BufferInfos);
+		DescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		DescriptorWrite.pImageInfo = NULL;
+		DescriptorWrite.pBufferInfo = BufferInfos;
+		DescriptorWrite.pTexelBufferView = NULL;
+
+		vkUpdateDescriptorSets(vkDevice, 1, &DescriptorWrite, 0, NULL);
+	}
+	while(++Frame != vkFrameEnd);
+
+
+	VkPipelineLayoutCreateInfo LayoutInfo = {0};
+	LayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	LayoutInfo.pNext = NULL;
+	LayoutInfo.flags = 0;
+	LayoutInfo.setLayoutCount = 1;
+	LayoutInfo.pSetLayouts = &vkParticleDescriptors;
+	LayoutInfo.pushConstantRangeCount = 0;
+	LayoutInfo.pPushConstantRanges = NULL;
+
+	Result = vkCreatePipelineLayout(vkDevice, &LayoutInfo, NULL, &vkParticleLayout);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VkShaderModule Shader = VulkanCreateShader("bin/particles.spv");
+
+	VkComputePipelineCreateInfo CreateInfo = {0};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	CreateInfo.pNext = NULL;
+	CreateInfo.flags = 0;
+	CreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	CreateInfo.stage.pNext = NULL;
+	CreateInfo.stage.flags = 0;
+	CreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	CreateInfo.stage.module = Shader;
+	CreateInfo.stage.pName = "main";
+	CreateInfo.stage.pSpecializationInfo = NULL;
+	CreateInfo.layout = vkParticleLayout;
+	CreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	CreateInfo.basePipelineIndex = -1;
+
+	Result = vkCreateComputePipelines(vkDevice, VK_NULL_HANDLE, 1, &CreateInfo, NULL, &vkParticlePipeline);
+	AssertEQ(Result, VK_SUCCESS);
+
+	VulkanDestroyShader(Shader);
+
+	vkParticleInstanceSet = VulkanCreateInstanceSet(vkParticleInstances);
+
+	vkParticleTime = VulkanTime();
+}
+
+
+static void
+VulkanDestroyParticles(
+	void
+	)
+{
+	vkDestroyPipeline(vkDevice, vkParticlePipeline, NULL);
+	vkDestroyPipelineLayout(vkDevice, vkParticleLayout, NULL);
+	vkDestroyDescriptorPool(vkDevice, vkParticleDescriptorPool, NULL);
+	vkDestroyDescriptorSetLayout(vkDevice, vkParticleDescriptors, NULL);
+
+	vkFreeMemory(vkDevice, vkParticleIndirectMemory, NULL);
+	vkDestroyBuffer(vkDevice, vkParticleIndirect, NULL);
+	vkFreeMemory(vkDevice, vkParticleInstanceMemory, NULL);
+	vkDestroyBuffer(vkDevice, vkParticleInstances, NULL);
+	vkFreeMemory(vkDevice, vkParticleMemory, NULL);
+	vkDestroyBuffer(vkDevice, vkParticleBuffer, NULL);
+}
+
+
+/*
+ * Advances the emitters and writes this frame's simulation inputs into the
+ * frame's constant buffer.
+ */
+static void
+VulkanUpdateParticles(
+	void
+	)
+{
+	double Now = vkChecking ? vkParticleTime + vkCheckStep : VulkanTime();
+	float Delta = vkReplaying ? vkLog.Frame.Delta : MIN(Now - vkParticleTime, 0.1);
+	vkParticleTime = Now;
+
+	VkParticleConstantInput* Constants = &vkFrame->ConstantData->Particles;
+	Constants->Delta = Delta;
+	Constants->Depth = vkParticleDepth;
+	Constants->Head = vkParticleHead;
+	Constants->Capacity = vkParticleCapacity;
+	Constants->EmitterCount = MIN(ARRAYLEN(vkEmitters), ARRAYLEN(Constants->Emitters));
+	Constants->Seed = vkReplaying ? vkLog.Frame.Seed : (uint32_t) vkFrameCount * 2654435761u;
+
+	if(vkLogging)
+	{
+		vkLog.Frame.Delta = Delta;
+		vkLog.Frame.Seed = Constants->Seed;
+	}
+
+	uint32_t Spawned = 0;
+
+	for(uint32_t i = 0; i < Constants->EmitterCount; ++i)
+	{
+		ParticleEmitter* Emitter = vkEmitters + i;
+		VkParticleEmitterInput* Input = Constants->Emitters + i;
+
+		Emitter->Pending += Emitter->Rate * Delta;
+
+		uint32_t Count = MIN((uint32_t) Emitter->Pending, vkParticleCapacity - Spawned);
+		Emitter->Pending -= Count;
+		Spawned += Count;
+
+		Input->Position[0] = Emitter->Position[0];
+		Input->Position[1] = Emitter->Position[1];
+		Input->Velocity[0] = Emitter->Velocity[0];
+		Input->Velocity[1] = Emitter->Velocity[1];
+		Input->Spread = Emitter->Spread;
+		Input->Life = Emitter->Life;
+		Input->Count = Count;
+		Input->TexIndex = Emitter->TexIndex;
+	}
+
+	vkParticleHead = (vkParticleHead + Spawned) % vkParticleCapacity;
+}
+
+
+/*
+ * Starts the simulation over, the next frame clears every particle again.
+ */
+static void
+VulkanResetParticles(
+	void
+	)
+{
+	vkParticleHead = 0;
+	vkParticlesCleared = 0;
+	vkParticleTime = VulkanTime();
+
+	for(uint32_t i = 0; i < ARRAYLEN(vkEmitters); ++i)
+	{
+		vkEmitters[i].Pending = 0.0f;
+	}
+}
+
+
+/*
+ * Zeroes the draw count the simulation appends to, and on the first frame
+ * the life of every particle.
+ */
+static void
+VulkanRecordParticleReset(
+	VkCommandBuffer CommandBuffer,
+	void* Data
+	)
+{
+	if(!vkParticlesCleared)
+	{
+		vkCmdFillBuffer(CommandBuffer, vkParticleBuffer, 0, VK_WHOLE_SIZE, 0);
+		vkParticlesCleared = 1;
+	}
+
+	VkDrawIndirectCommand Command = {0};
+	Command.vertexCount = ARRAYLEN(vkVertexVertexInput);
+	Command.instanceCount = 0;
+	Command.firstVertex = 0;
+	Command.firstInstance = 0;
+
+	vkCmdUpdateBuffer(CommandBuffer, vkParticleIndirect, 0, sizeof(Command), &Command);
+}
+
+
+static void
+VulkanRecordParticles(
+	VkCommandBuffer CommandBuffer,
+	void* Data
+	)
+{
+	vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, vkParticlePipeline);
+	vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+		vkParticleLayout, 0, 1, &vkFrame->ParticleSet, 0, NULL);
+	vkCmdDispatch(CommandBuffer, (vkParticleCapacity + 255) / 256, 1, 1);
+}
+
+
+static void
+VulkanDrawParticles(
+	void
+	)
+{
+	vkCmdBindPipeline(vkFrame->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, VulkanGetPipeline(BLEND_ADDITIVE));
+	vkCmdBindDescriptorSets(vkFrame->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+		vkPipelineLayout, 0, 1, vkFrame->DescriptorSets, 0, NULL);
+
+	VulkanBindInstances(vkParticleInstances, vkParticleInstanceSet);
+
+	vkCmdDrawIndirect(vkFrame->CommandBuffer, vkParticleIndirect, 0, 1, sizeof(VkDrawIndirectCommand));
+}
+
+
+static void
+VulkanUpdateConstants(
+	void
+	)
+{
+	float AspectRatio = (float) vkExtent.width / vkExtent.height;
+	vec3 RotationAxis = { 0.0f, 1.0f, 0.0f };
+	vec3 Eye = { 0.0f, 0.001f, 3.0f };
+	vec3 Center = { 0.0f, 0.0f, 0.0f };
+	vec3 Up = { 0.0f, 0.0f, 1.0f };
+
+	mat4 Model;
+	glm_mat4_identity(Model);
+	glm_rotate(Model, vkRotation, RotationAxis);
+
+	mat4 View;
+	glm_mat4_identity(View);
+	glm_lookat(Eye, Center, Up, View);
+
+	mat4 Projection;
+	glm_mat4_identity(Projection);
+	glm_perspective(glm_rad(45), AspectRatio, 1000.0f, 0.01f, Projection);
+	//glm_ortho_default((float) vkExtent.width / vkExtent.height, Input.Projection);
+
+	mat4* Matrices[] =
+	{
+		&Projection,
+		&View,
+		&Model
+	};
+
+	glm_mat4_mulN(Matrices, ARRAYLEN(Matrices), vkFrame->ConstantData->Vertex.Transform);
+}
+
+
+static void
+VulkanRecordUpscale(
+	VkCommandBuffer CommandBuffer,
+	void* Data
+	)
+{
+	VkImage* Output = Data;
+
+	VkImageBlit Blit = {0};
+	Blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	Blit.srcSubresource.mipLevel = 0;
+	Blit.srcSubresource.baseArrayLayer = 0;
+	Blit.srcSubresource.layerCount = 1;
+	Blit.srcOffsets[1].x = vkRenderExtent.width;
+	Blit.srcOffsets[1].y = vkRenderExtent.height;
+	Blit.srcOffsets[1].z = 1;
+	Blit.dstSubresource = Blit.srcSubresource;
+	Blit.dstOffsets[1].x = vkExtent.width;
+	Blit.dstOffsets[1].y = vkExtent.height;
+	Blit.dstOffsets[1].z = 1;
+
+	vkCmdBlitImage(CommandBuffer, vkOffscreen.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		*Output, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &Blit, VK_FILTER_LINEAR);
+}
+
+
+/*
+ * Copies the finished output image into the capture buffer. Clearing
+ * vkCapturing here tells VulkanCheck() the frame was not dropped.
+ */
+static void
+VulkanRecordCapture(
+	VkCommandBuffer CommandBuffer,
+	void* Data
+	)
+{
+	VkImage* Output = Data;
+
+	VkBufferImageCopy Region = {0};
+	Region.bufferOffset = 0;
+	Region.bufferRowLength = 0;
+	Region.bufferImageHeight = 0;
+	Region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	Region.imageSubresource.mipLevel = 0;
+	Region.imageSubresource.baseArrayLayer = 0;
+	Region.imageSubresource.layerCount = 1;
+	Region.imageOffset = (VkOffset3D){ 0, 0, 0 };
+	Region.imageExtent = (VkExtent3D){ vkExtent.width, vkExtent.height, 1 };
+
+	vkCmdCopyImageToBuffer(CommandBuffer, *Output, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		vkCaptureBuffer, 1, &Region);
+
+	vkCapturing = 0;
+}
+
+
+static void
+VulkanSetViewport(
+	VkCommandBuffer CommandBuffer
+	)
+{
+	VkViewport Viewport = {0};
+	Viewport.x = 0.0f;
+	Viewport.y = 0.0f;
+	Viewport.width = vkRenderExtent.width;
+	Viewport.height = vkRenderExtent.height;
+	Viewport.minDepth = 0.0f;
+	Viewport.maxDepth = 1.0f;
+
+	vkCmdSetViewport(CommandBuffer, 0, 1, &Viewport);
+
+	VkRect2D Scissor = {0};
+	Scissor.offset.x = 0;
+	Scissor.offset.y = 0;
+	Scissor.extent = vkRenderExtent;
+
+	vkCmdSetScissor(CommandBuffer, 0, 1, &Scissor);
+}
+
+
+static void
+VulkanRecordDraws(
+	VkCommandBuffer CommandBuffer
+	)
+{
+	VkDeviceSize Offset = 0;
+
+	if(!vkVertexPulling)
+	{
+		vkCmdBindVertexBuffers(CommandBuffer, 0, 1, &vkVertexVertexInputBuffer, &Offset);
+	}
+
+	VulkanBindInstances(vkFrame->Instances, vkFrame->InstanceSet);
+
+	VulkanRecordTilemap();
+
+	uint32_t Blend = UINT32_MAX;
+	uint32_t Descriptor = UINT32_MAX;
+
+	Batch* Draw = vkBatches;
+	Batch* DrawEnd = vkBatches + vkBatchCount;
+
+	for(; Draw != DrawEnd; ++Draw)
+	{
+		if(Draw->Blend != Blend)
+		{
+			Blend = Draw->Blend;
+			vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, VulkanGetPipeline(Blend));
+		}
+
+		if(Draw->Descriptor != Descriptor)
+		{
+			Descriptor = Draw->Descriptor;
+			vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+				vkPipelineLayout, 0, 1, vkFrame->DescriptorSets + Descriptor, 0, NULL);
+		}
+
+		vkCmdDraw(CommandBuffer, ARRAYLEN(vkVertexVertexInput), Draw->Count, 0, Draw->First);
+	}
+
+	VulkanDrawParticles();
+}
+
+
+static void
+VulkanRecordHeat(
+	VkCommandBuffer CommandBuffer,
+	void* Data
+	)
+{
+	VkClearValue ClearValue = {0};
+	ClearValue.color = (VkClearColorValue){{ 0.0f, 0.0f, 0.0f, 0.0f }};
+
+	VkRenderPassBeginInfo RenderPassInfo = {0};
+	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	RenderPassInfo.pNext = NULL;
+	RenderPassInfo.renderPass = vkHeatRenderPass;
+	RenderPassInfo.framebuffer = vkHeatFramebuffer;
+	RenderPassInfo.renderArea.offset.x = 0;
+	RenderPassInfo.renderArea.offset.y = 0;
+	RenderPassInfo.renderArea.extent = vkRenderExtent;
+	RenderPassInfo.clearValueCount = 1;
+	RenderPassInfo.pClearValues = &ClearValue;
+
+	vkCmdBeginRenderPass(CommandBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VulkanSetViewport(CommandBuffer);
+
+	vkHeatRecording = 1;
+	VulkanRecordDraws(CommandBuffer);
+	vkHeatRecording = 0;
+
+	vkCmdEndRenderPass(CommandBuffer);
+}
+
+
+static void
+VulkanRecordScene(
+	VkCommandBuffer CommandBuffer,
+	void* Data
+	)
+{
+	VkFramebuffer* Framebuffer = Data;
+
+	VkClearValue ClearValues[2] = {0};
+
+	ClearValues[0].color = (VkClearColorValue){{ 0.0f, 0.0f, 0.0f, 0.0f }};
+	ClearValues[1].depthStencil = (VkClearDepthStencilValue){ 0.0f, 0 };
+
+
+	VkRenderPassBeginInfo RenderPassInfo = {0};
+	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	RenderPassInfo.pNext = NULL;
+	RenderPassInfo.renderPass = vkRenderPass;
+	RenderPassInfo.framebuffer = *Framebuffer;
+	RenderPassInfo.renderArea.offset.x = 0;
+	RenderPassInfo.renderArea.offset.y = 0;
+	RenderPassInfo.renderArea.extent = vkRenderExtent;
+	RenderPassInfo.clearValueCount = ARRAYLEN(ClearValues);
+	RenderPassInfo.pClearValues = ClearValues;
+
+	vkCmdBeginRenderPass(CommandBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VulkanSetViewport(CommandBuffer);
+
+	if(vkHeatMap)
+	{
+		vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkPipelines[PIPELINE_HEAT_MAP]);
+		vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			vkHeatLayout, 0, 1, &vkHeatSet, 0, NULL);
+		vkCmdDraw(CommandBuffer, 3, 1, 0, 0);
+	}
+	else
+	{
+		VulkanRecordDraws(CommandBuffer);
+	}
+
+	vkCmdEndRenderPass(CommandBuffer);
+}
+
+
+/*
+ * Declares the frame to the graph. Imports describe how the previous frame
+ * left each resource, which is the same every frame, so a recording reused
+ * for a static frame still carries the right barriers.
+ */
+static void
+VulkanBuildGraph(
+	uint32_t ImageIndex
+	)
+{
+	const VkPipelineStageFlags VertexStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+	const VkAccessFlags VertexAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+	GraphReset(&vkGraph);
+
+	vkDepthAttachment = GraphCreateImage(&vkGraph, VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, vkSamples, vkExtent);
+	vkColorAttachment = UINT32_MAX;
+
+	if(vkSamples != VK_SAMPLE_COUNT_1_BIT)
+	{
+		vkColorAttachment = GraphCreateImage(&vkGraph, VK_FORMAT_B8G8R8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, vkSamples, vkExtent);
+	}
+
+	uint32_t Tiles = GraphImportBuffer(&vkGraph, VertexStages, VertexAccess);
+	uint32_t Particles = GraphImportBuffer(&vkGraph, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+	uint32_t Instances = GraphImportBuffer(&vkGraph, VertexStages, VertexAccess);
+	uint32_t Indirect = GraphImportBuffer(&vkGraph, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+
+	uint32_t Swapchain = GraphImportImage(&vkGraph, vkImages[ImageIndex], VK_IMAGE_ASPECT_COLOR_BIT, 1,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED);
+	uint32_t Output = Swapchain;
+
+	uint32_t Heat = UINT32_MAX;
+	uint32_t Capture = UINT32_MAX;
+
+	if(vkCapturing)
+	{
+		Capture = GraphImportBuffer(&vkGraph, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+	}
+
+	if(vkHeatMap)
+	{
+		Heat = GraphImportImage(&vkGraph, vkHeatImage.Image, VK_IMAGE_ASPECT_COLOR_BIT, 1,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	if(vkScaling)
+	{
+		Output = GraphImportImage(&vkGraph, vkOffscreen.Image, VK_IMAGE_ASPECT_COLOR_BIT, 1,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	}
+
+	int Uploads = MIN(vkDirtyChunkCount, vkChunkUploads) != 0;
+
+	GraphAddPass(&vkGraph, Uploads ? VulkanRecordTileUploads : NULL, NULL);
+
+	if(Uploads)
+	{
+		GraphUseBuffer(&vkGraph, Tiles, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	}
+
+	GraphAddPass(&vkGraph, VulkanRecordParticleReset, NULL);
+
+	if(!vkParticlesCleared)
+	{
+		GraphUseBuffer(&vkGraph, Particles, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	}
+
+	GraphUseBuffer(&vkGraph, Indirect, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	GraphAddPass(&vkGraph, VulkanRecordParticles, NULL);
+	GraphUseBuffer(&vkGraph, Particles, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+	GraphUseBuffer(&vkGraph, Instances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+	GraphUseBuffer(&vkGraph, Indirect, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	GraphAddPass(&vkGraph, vkHeatMap ? VulkanRecordHeat : NULL, NULL);
+
+	if(vkHeatMap)
+	{
+		GraphUseBuffer(&vkGraph, Tiles, VertexStages, VertexAccess);
+		GraphUseBuffer(&vkGraph, Instances, VertexStages, VertexAccess);
+		GraphUseBuffer(&vkGraph, Indirect, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+		GraphUseImage(&vkGraph, Heat, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	GraphAddPass(&vkGraph, VulkanRecordScene, vkFramebuffers + ImageIndex);
+
+	GraphUseImage(&vkGraph, vkDepthAttachment, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+		VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+
+	if(vkColorAttachment != UINT32_MAX)
+	{
+		GraphUseImage(&vkGraph, vkColorAttachment, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+	}
+
+	if(vkHeatMap)
+	{
+		GraphUseImage(&vkGraph, Heat, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+	else
+	{
+		GraphUseBuffer(&vkGraph, Tiles, VertexStages, VertexAccess);
+		GraphUseBuffer(&vkGraph, Instances, VertexStages, VertexAccess);
+		GraphUseBuffer(&vkGraph, Indirect, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	}
+
+	GraphUseImage(&vkGraph, Output, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+		vkScaling ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	GraphAddPass(&vkGraph, vkScaling ? VulkanRecordUpscale : NULL, vkImages + ImageIndex);
+
+	if(vkScaling)
+	{
+		GraphUseImage(&vkGraph, Output, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		GraphUseImage(&vkGraph, Swapchain, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	}
+
+	GraphAddPass(&vkGraph, vkCapturing ? VulkanRecordCapture : NULL, vkImages + ImageIndex);
+
+	if(vkCapturing)
+	{
+		GraphUseImage(&vkGraph, Swapchain, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		GraphUseBuffer(&vkGraph, Capture, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	}
+
+	GraphAddPass(&vkGraph, NULL, NULL);
+	GraphUseImage(&vkGraph, Swapchain, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	if(vkCapturing)
+	{
+		GraphUseBuffer(&vkGraph, Capture, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+	}
+}
+
+
+static void
+VulkanRecordCommands(
+	uint32_t ImageIndex
+	)
+{
+	VkCommandBufferBeginInfo BeginInfo = {0};
+	BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	BeginInfo.pNext = NULL;
+	BeginInfo.flags = 0;
+	BeginInfo.pInheritanceInfo = NULL;
+
+	VkResult Result = vkBeginCommandBuffer(vkFrame->CommandBuffer, &BeginInfo);
+	AssertEQ(Result, VK_SUCCESS);
+
+	uint32_t Query = (vkFrame - vkFrames) * 2;
+
+	if(vkTimestampBits != 0)
+	{
+		vkCmdResetQueryPool(vkFrame->CommandBuffer, vkQueryPool, Query, 2);
+		vkCmdWriteTimestamp(vkFrame->CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, vkQueryPool, Query);
+	}
+
+	VulkanRecordAcquires();
+	VulkanBuildGraph(ImageIndex);
+
+	uint32_t Statistics = vkFrame - vkFrames;
+
+	if(vkStatisticsSupported)
+	{
+		vkCmdResetQueryPool(vkFrame->CommandBuffer, vkStatisticsPool, Statistics, 1);
+		vkCmdBeginQuery(vkFrame->CommandBuffer, vkStatisticsPool, Statistics, 0);
+	}
+
+	GraphExecute(&vkGraph, vkFrame->CommandBuffer);
+
+	if(vkStatisticsSupported)
+	{
+		vkCmdEndQuery(vkFrame->CommandBuffer, vkStatisticsPool, Statistics);
+		vkFrame->Counted = 1;
+	}
+
+	if(vkTimestampBits != 0)
+	{
+		vkCmdWriteTimestamp(vkFrame->CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, vkQueryPool, Query + 1);
+		vkFrame->Timed = 1;
+	}
+
+	Result = vkEndCommandBuffer(vkFrame->CommandBuffer);
+	AssertEQ(Result, VK_SUCCESS);
+}
+
+
+/*
+ * Everything recorded that is not covered by vkRecordGeneration: the batch
+ * layout, the extents baked into the render area and the upscale blit, and
+ * the visible chunks with their tile counts. Moving the view only changes
+ * the key when it crosses into other chunks. The words are left in
+ * vkRecordingWords and their hash is returned.
+ */
+static uint64_t
+VulkanGetRecordingKey(
+	void
+	)
+{
+	int32_t Range[4];
+	uint32_t Chunks = 0;
 
-	vkFramebuffers = calloc(vkImageCount, sizeof(*vkFramebuffers));
-	AssertNEQ(vkFramebuffers, NULL);
+	if(VulkanGetVisibleChunks(Range))
+	{
+		Chunks = (Range[2] - Range[0] + 1) * (Range[3] - Range[1] + 1);
+	}
+	else
+	{
+		Range[0] = Range[1] = Range[2] = Range[3] = -1;
+	}
 
-	VkFramebuffer* Framebuffer = vkFramebuffers;
+	uint32_t Count = 11 + vkBatchCount * 4 + Chunks;
 
-	while(1)
+	vkRecordingWords = GrowArray(vkRecordingWords, &vkRecordingWordSize, Count - 1, sizeof(*vkRecordingWords));
+
+	uint32_t* Words = vkRecordingWords;
+
+	*(Words++) = vkBatchCount;
+	*(Words++) = vkRenderExtent.width;
+	*(Words++) = vkRenderExtent.height;
+	*(Words++) = vkExtent.width;
+	*(Words++) = vkExtent.height;
+	*(Words++) = vkScaling;
+	*(Words++) = vkHeatMap;
+
+	for(uint32_t i = 0; i < ARRAYLEN(Range); ++i)
 	{
-		VkImageView Attachments[] =
-		{
-			vkMultisampling.View,
-			vkDepthBuffer.View,
-			*ImageView
-		};
+		*(Words++) = Range[i];
+	}
 
-		VkFramebufferCreateInfo CreateInfo = {0};
-		CreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		CreateInfo.pNext = NULL;
-		CreateInfo.flags = 0;
-		CreateInfo.renderPass = vkRenderPass;
-		CreateInfo.attachmentCount = ARRAYLEN(Attachments);
-		CreateInfo.pAttachments = Attachments;
-		CreateInfo.width = vkExtent.width;
-		CreateInfo.height = vkExtent.height;
-		CreateInfo.layers = 1;
+	for(uint32_t i = 0; i < vkBatchCount; ++i)
+	{
+		const Batch* Draw = vkBatches + i;
 
-		VkResult Result = vkCreateFramebuffer(vkDevice, &CreateInfo, NULL, Framebuffer);
-		AssertEQ(Result, VK_SUCCESS);
+		*(Words++) = Draw->Blend;
+		*(Words++) = Draw->Descriptor;
+		*(Words++) = Draw->First;
+		*(Words++) = Draw->Count;
+	}
 
-		if(++ImageView == ImageViewEnd)
+	for(int32_t Y = Range[1]; Chunks != 0 && Y <= Range[3]; ++Y)
+	{
+		for(int32_t X = Range[0]; X <= Range[2]; ++X)
 		{
-			break;
+			*(Words++) = vkChunks[Y * vkChunksX + X].Count;
 		}
+	}
 
-		++Framebuffer;
+	vkRecordingWordCount = Count;
+
+	uint64_t Key = UINT64_C(14695981039346656037);
+
+	for(uint32_t i = 0; i < Count; ++i)
+	{
+		Key = (Key ^ vkRecordingWords[i]) * UINT64_C(1099511628211);
 	}
+
+	return Key;
 }
 
 
-static void
-VulkanDestroyFramebuffers(
-	void
+/*
+ * Picks the frame's recording for ImageIndex and says whether it can be
+ * submitted as is. Frames that carry one-off work, acquires, tile uploads,
+ * the particle clear or a capture, are recorded and never reused.
+ */
+static int
+VulkanReuseCommands(
+	uint32_t ImageIndex
 	)
 {
-	VkFramebuffer* Framebuffer = vkFramebuffers;
-	VkFramebuffer* FramebufferEnd = vkFramebuffers + vkImageCount;
+	if(vkFrame->Recordings == NULL)
+	{
+		return 0;
+	}
 
-	do
+	VkRecording* Recording = vkFrame->Recordings + ImageIndex;
+	vkFrame->CommandBuffer = Recording->CommandBuffer;
+
+	uint64_t Key = VulkanGetRecordingKey();
+
+	int OneOff =
+		vkImageAcquireCount != 0 ||
+		vkBufferAcquireCount != 0 ||
+		vkDirtyChunkCount != 0 ||
+		!vkParticlesCleared ||
+		vkCapturing;
+
+	if(
+		!OneOff &&
+		Recording->Generation == vkRecordGeneration &&
+		Recording->Key == Key &&
+		Recording->WordCount == vkRecordingWordCount &&
+		memcmp(Recording->Words, vkRecordingWords, sizeof(*vkRecordingWords) * vkRecordingWordCount) == 0
+		)
 	{
-		vkDestroyFramebuffer(vkDevice, *Framebuffer, NULL);
+		vkFrame->Timed = vkTimestampBits != 0;
+		vkFrame->Counted = vkStatisticsSupported;
+		return 1;
 	}
-	while(++Framebuffer != FramebufferEnd);
 
-	free(vkFramebuffers);
+	Recording->Generation = OneOff ? 0 : vkRecordGeneration;
+	Recording->Key = Key;
+
+	Recording->Words = GrowArray(Recording->Words, &Recording->WordSize, vkRecordingWordCount - 1,
+		sizeof(*Recording->Words));
+
+	memcpy(Recording->Words, vkRecordingWords, sizeof(*vkRecordingWords) * vkRecordingWordCount);
+	Recording->WordCount = vkRecordingWordCount;
+
+	return 0;
 }
 
 
 static void
-VulkanInitPipeline(
+VulkanDraw(
 	void
 	)
 {
-	VulkanCreateTexture("textures/4x4x4.png", &vkTexture);
+	VulkanApplyReload();
 
-	VkAttachmentReference ColorAttachmentRef = {0};
-	ColorAttachmentRef.attachment = 0;
-	ColorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	for(; vkQualityStep > 0; --vkQualityStep)
+	{
+		VulkanStepQuality();
+	}
 
-	VkAttachmentReference DepthAttachmentRef = {0};
-	DepthAttachmentRef.attachment = 1;
-	DepthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	if(vkScalingToggle & 1)
+	{
+		VulkanSetScaling(!vkScaling);
+	}
 
-	VkAttachmentReference MultisamplingRef = {0};
-	MultisamplingRef.attachment = 2;
-	MultisamplingRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	vkScalingToggle = 0;
 
-	VkSubpassDescription Subpass = {0};
-	Subpass.flags = 0;
-	Subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	Subpass.inputAttachmentCount = 0;
-	Subpass.pInputAttachments = NULL;
-	Subpass.colorAttachmentCount = 1;
-	Subpass.pColorAttachments = &ColorAttachmentRef;
-	Subpass.pResolveAttachments = &MultisamplingRef;
-	Subpass.pDepthStencilAttachment = &DepthAttachmentRef;
-	Subpass.preserveAttachmentCount = 0;
-	Subpass.pPreserveAttachments = NULL;
+	if(vkHeatMapToggle & 1)
+	{
+		vkHeatMap = !vkHeatMap && vkHeatRenderPass != VK_NULL_HANDLE;
+	}
 
-	VkSubpassDependency Dependency = {0};
-	Dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	Dependency.dstSubpass = 0;
-	Dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	Dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	Dependency.srcAccessMask = 0;
-	Dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	Dependency.dependencyFlags = 0;
+	vkHeatMapToggle = 0;
 
-	VkAttachmentDescription Attachments[3] = {0};
+	VkResult Result;
+
+	if(vkTimeline)
+	{
+		VulkanWaitTimeline(vkFrameSemaphore, vkFrame->Value);
+	}
+	else
+	{
+		Result = vkWaitForFences(vkDevice, 1, vkFrame->Fences + FENCE_IN_FLIGHT, VK_TRUE, UINT64_MAX);
+		AssertEQ(Result, VK_SUCCESS);
+	}
+
+	VulkanCollectRetired(0);
+	VulkanReadFrameTime();
+	VulkanReadStatistics();
+
+	VulkanUpdateScene();
+	VulkanDrawScene();
+	VulkanBuildDrawList();
+
+	if(vkFrame->StaleDescriptors)
+	{
+		VulkanUpdateDescriptors(vkFrame);
+	}
+
+	/* Each headless frame owns the image of the same index */
+	uint32_t ImageIndex = vkFrame - vkFrames;
+
+	if(!vkChecking)
+	{
+		Result = vkAcquireNextImageKHR(vkDevice, vkSwapchain, UINT64_MAX,
+			vkFrame->Semaphores[SEMAPHORE_IMAGE_AVAILABLE], VK_NULL_HANDLE, &ImageIndex);
+
+		if(Result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			vkExtent = VulkanGetExtent();
+
+			return;
+		}
+	}
+
+	if(!vkTimeline)
+	{
+		Result = vkResetFences(vkDevice, 1, vkFrame->Fences + FENCE_IN_FLIGHT);
+		AssertEQ(Result, VK_SUCCESS);
+	}
+
+
+	VulkanUpdateConstants();
+	VulkanUpdateParticles();
+
+	if(!VulkanReuseCommands(ImageIndex))
+	{
+		Result = vkResetCommandBuffer(vkFrame->CommandBuffer, 0);
+		AssertEQ(Result, VK_SUCCESS);
+
+		VulkanRecordCommands(ImageIndex);
+	}
+
+	VkPipelineStageFlags WaitStages[] =
+	{
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		vkAcquireStages
+	};
+
+	VkSemaphore WaitSemaphores[] =
+	{
+		vkFrame->Semaphores[SEMAPHORE_IMAGE_AVAILABLE],
+		vkTransferSemaphore
+	};
+
+	VkSemaphore SignalSemaphores[] =
+	{
+		vkFrame->Semaphores[SEMAPHORE_RENDER_FINISHED],
+		vkFrameSemaphore
+	};
+
+	/*
+	 * Binary semaphores ignore their values, the timeline ones wait for the
+	 * last upload and mark this frame as done once it reaches vkFrameValue.
+	 */
+	uint64_t WaitValues[] = { 0, vkTransferValue };
+	uint64_t SignalValues[] = { 0, vkFrameValue + 1 };
+
+	/* Without a swapchain there is nothing to acquire or to present */
+	uint32_t Skipped = vkChecking ? 1 : 0;
+	uint32_t WaitCount = (vkTransferPending ? 2 : 1) - Skipped;
+	uint32_t SignalCount = (vkTimeline ? 2 : 1) - Skipped;
+
+	VkTimelineSemaphoreSubmitInfo TimelineInfo = {0};
+	TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	TimelineInfo.pNext = NULL;
+	TimelineInfo.waitSemaphoreValueCount = WaitCount;
+	TimelineInfo.pWaitSemaphoreValues = WaitValues + Skipped;
+	TimelineInfo.signalSemaphoreValueCount = SignalCount;
+	TimelineInfo.pSignalSemaphoreValues = SignalValues + Skipped;
+
+	VkSubmitInfo SubmitInfo = {0};
+	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	SubmitInfo.pNext = vkTimeline ? &TimelineInfo : NULL;
+	SubmitInfo.waitSemaphoreCount = WaitCount;
+	SubmitInfo.pWaitSemaphores = WaitSemaphores + Skipped;
+	SubmitInfo.pWaitDstStageMask = WaitStages + Skipped;
+	SubmitInfo.commandBufferCount = 1;
+	SubmitInfo.pCommandBuffers = &vkFrame->CommandBuffer;
+	SubmitInfo.signalSemaphoreCount = SignalCount;
+	SubmitInfo.pSignalSemaphores = SignalSemaphores + Skipped;
+
+	Result = vkQueueSubmit(vkQueue, 1, &SubmitInfo, vkFrame->Fences[FENCE_IN_FLIGHT]);
+	AssertEQ(Result, VK_SUCCESS);
+
+	vkTransferPending = 0;
+
+	vkFrame->Value = ++vkFrameValue;
+
+	if(!vkChecking)
+	{
+		VkPresentInfoKHR PresentInfo = {0};
+		PresentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		PresentInfo.pNext = NULL;
+		PresentInfo.waitSemaphoreCount = 1;
+		PresentInfo.pWaitSemaphores = vkFrame->Semaphores + SEMAPHORE_RENDER_FINISHED;
+		PresentInfo.swapchainCount = 1;
+		PresentInfo.pSwapchains = &vkSwapchain;
+		PresentInfo.pImageIndices = &ImageIndex;
+		PresentInfo.pResults = NULL;
+
+		Result = vkQueuePresentKHR(vkQueue, &PresentInfo);
+
+		if(Result == VK_ERROR_OUT_OF_DATE_KHR || Result == VK_SUBOPTIMAL_KHR)
+		{
+			vkExtent = VulkanGetExtent();
+		}
+	}
+
+	if(++vkFrame == vkFrameEnd)
+	{
+		vkFrame = vkFrames;
+	}
 
-	Attachments[0].flags = 0;
-	Attachments[0].format = VK_FORMAT_B8G8R8A8_SRGB;
-	Attachments[0].samples = vkSamples;
-	Attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	Attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	Attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	Attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	Attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	Attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	++vkFrameCount;
+}
 
-	Attachments[1].flags = 0;
-	Attachments[1].format = VK_FORMAT_D32_SFLOAT;
-	Attachments[1].samples = vkSamples;
-	Attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	Attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	Attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	Attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	Attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	Attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-	Attachments[2].flags = 0;
-	Attachments[2].format = VK_FORMAT_B8G8R8A8_SRGB;
-	Attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
-	Attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	Attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	Attachments[2].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	Attachments[2].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	Attachments[2].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	Attachments[2].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+/*
+ * Starts from a conservative tier rather than timing the startup scene,
+ * which is far lighter than a real one. Dynamic resolution moves the tier up
+ * from here once the full scale leaves enough headroom.
+ */
+static void
+VulkanInitQuality(
+	void
+	)
+{
+	uint32_t Quality = vkQualityStart;
 
-	VkRenderPassCreateInfo RenderPassInfo = {0};
-	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	RenderPassInfo.pNext = NULL;
-	RenderPassInfo.flags = 0;
-	RenderPassInfo.attachmentCount = ARRAYLEN(Attachments);
-	RenderPassInfo.pAttachments = Attachments;
-	RenderPassInfo.subpassCount = 1;
-	RenderPassInfo.pSubpasses = &Subpass;
-	RenderPassInfo.dependencyCount = 1;
-	RenderPassInfo.pDependencies = &Dependency;
+	while(Quality > 0 && !VulkanQualitySupported(Quality))
+	{
+		--Quality;
+	}
 
-	VkResult Result = vkCreateRenderPass(vkDevice, &RenderPassInfo, NULL, &vkRenderPass);
-	AssertEQ(Result, VK_SUCCESS);
+	VulkanSetQuality(Quality);
+}
 
 
-	VkShaderModule VertexModule = VulkanCreateShader("bin/vert.spv");
-	VkShaderModule FragmentModule = VulkanCreateShader("bin/frag.spv");
+/*
+ * Compares the capture buffer, converted to a binary PPM, against the
+ * reference at Path. A pixel differs when any channel is off by more than
+ * vkGoldenTolerance, and the scene fails when more than vkGoldenMismatch of
+ * them do. Returns 0 when the scene passes or the reference was written.
+ */
+static int
+VulkanCheckGolden(
+	const char* Path
+	)
+{
+	char Header[32];
+	int HeaderLength = snprintf(Header, sizeof(Header), "P6\n%u %u\n255\n", vkExtent.width, vkExtent.height);
 
-	VkPipelineShaderStageCreateInfo Stages[2] = {0};
+	uint32_t Pixels = vkExtent.width * vkExtent.height;
+	uint64_t Length = HeaderLength + (uint64_t) Pixels * 3;
 
-	Stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	Stages[0].pNext = NULL;
-	Stages[0].flags = 0;
-	Stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-	Stages[0].module = VertexModule;
-	Stages[0].pName = "main";
-	Stages[0].pSpecializationInfo = NULL;
+	uint8_t* Image = malloc(Length);
+	AssertNEQ(Image, NULL);
 
-	Stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	Stages[1].pNext = NULL;
-	Stages[1].flags = 0;
-	Stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	Stages[1].module = FragmentModule;
-	Stages[1].pName = "main";
-	Stages[1].pSpecializationInfo = NULL;
+	memcpy(Image, Header, HeaderLength);
 
-	VkVertexInputBindingDescription VertexBindings[2] = {0};
+	/* The output images are B8G8R8A8 */
+	uint8_t* Pixel = Image + HeaderLength;
 
-	VertexBindings[0].binding = 0;
-	VertexBindings[0].stride = sizeof(VkVertexVertexInput);
-	VertexBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	for(uint32_t i = 0; i < Pixels; ++i)
+	{
+		Pixel[i * 3 + 0] = vkCaptureData[i * 4 + 2];
+		Pixel[i * 3 + 1] = vkCaptureData[i * 4 + 1];
+		Pixel[i * 3 + 2] = vkCaptureData[i * 4 + 0];
+	}
 
-	VertexBindings[1].binding = 1;
-	VertexBindings[1].stride = sizeof(VkVertexInstanceInput);
-	VertexBindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	if(vkCheckUpdate)
+	{
+		int Status = WriteFile(Path, Length, Image);
+		free(Image);
 
-	VkVertexInputAttributeDescription Attributes[6] = {0};
+		printf("golden %s %s\n", Path, Status == 0 ? "written" : "could not be written");
 
-	Attributes[0].location = 0;
-	Attributes[0].binding = 0;
-	Attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	Attributes[0].offset = offsetof(VkVertexVertexInput, Position);
+		return Status;
+	}
 
-	Attributes[1].location = 1;
-	Attributes[1].binding = 0;
-	Attributes[1].format = VK_FORMAT_R32G32_SFLOAT;
-	Attributes[1].offset = offsetof(VkVertexVertexInput, TexCoord);
+	uint64_t GoldenLength;
+	uint8_t* Golden;
 
-	Attributes[2].location = 2;
-	Attributes[2].binding = 1;
-	Attributes[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-	Attributes[2].offset = offsetof(VkVertexInstanceInput, Position);
+	if(ReadFile(Path, &GoldenLength, &Golden) == -1)
+	{
+		free(Image);
 
-	Attributes[3].location = 3;
-	Attributes[3].binding = 1;
-	Attributes[3].format = VK_FORMAT_R32G32_SFLOAT;
-	Attributes[3].offset = offsetof(VkVertexInstanceInput, Dimensions);
+		printf("golden %s MISSING, write it with VULKAN_CHECK_UPDATE\n", Path);
 
-	Attributes[4].location = 4;
-	Attributes[4].binding = 1;
-	Attributes[4].format = VK_FORMAT_R32_SFLOAT;
-	Attributes[4].offset = offsetof(VkVertexInstanceInput, Rotation);
+		return -1;
+	}
 
-	Attributes[5].location = 5;
-	Attributes[5].binding = 1;
-	Attributes[5].format = VK_FORMAT_R32_UINT;
-	Attributes[5].offset = offsetof(VkVertexInstanceInput, TexIndex);
+	if(GoldenLength != Length || memcmp(Golden, Header, HeaderLength) != 0)
+	{
+		free(Golden);
+		free(Image);
 
-	VkPipelineVertexInputStateCreateInfo VertexInput = {0};
-	VertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	VertexInput.pNext = NULL;
-	VertexInput.flags = 0;
-	VertexInput.vertexBindingDescriptionCount = ARRAYLEN(VertexBindings);
-	VertexInput.pVertexBindingDescriptions = VertexBindings;
-	VertexInput.vertexAttributeDescriptionCount = ARRAYLEN(Attributes);
-	VertexInput.pVertexAttributeDescriptions = Attributes;
+		printf("golden %s FAILED, size differs from %ux%u\n", Path, vkExtent.width, vkExtent.height);
 
-	VkPipelineInputAssemblyStateCreateInfo InputAssembly = {0};
-	InputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	InputAssembly.pNext = NULL;
-	InputAssembly.flags = 0;
-	InputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
-	InputAssembly.primitiveRestartEnable = VK_FALSE;
+		return -1;
+	}
 
-	VkViewport Viewport = {0};
-	Viewport.x = 0.0f;
-	Viewport.y = 0.0f;
-	Viewport.width = vkExtent.width;
-	Viewport.height = vkExtent.height;
-	Viewport.minDepth = 0.0f;
-	Viewport.maxDepth = 1.0f;
+	uint32_t Mismatched = 0;
 
-	VkRect2D Scissor = {0};
-	Scissor.offset.x = 0;
-	Scissor.offset.y = 0;
-	Scissor.extent = vkExtent;
+	for(uint32_t i = 0; i < Pixels; ++i)
+	{
+		for(uint32_t j = 0; j < 3; ++j)
+		{
+			int Difference = (int) Pixel[i * 3 + j] - (int) Golden[HeaderLength + i * 3 + j];
 
-	VkPipelineViewportStateCreateInfo ViewportState = {0};
-	ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	ViewportState.pNext = NULL;
-	ViewportState.flags = 0;
-	ViewportState.viewportCount = 1;
-	ViewportState.pViewports = &Viewport;
-	ViewportState.scissorCount = 1;
-	ViewportState.pScissors = &Scissor;
+			if((uint32_t) abs(Difference) > vkGoldenTolerance)
+			{
+				++Mismatched;
+				break;
+			}
+		}
+	}
 
-	VkPipelineRasterizationStateCreateInfo Rasterizer = {0};
-	Rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	Rasterizer.pNext = NULL;
-	Rasterizer.flags = 0;
-	Rasterizer.depthClampEnable = VK_FALSE;
-	Rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	Rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	Rasterizer.cullMode = VK_CULL_MODE_NONE; // VK_CULL_MODE_BACK_BIT;
-	Rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-	Rasterizer.depthBiasEnable = VK_FALSE;
-	Rasterizer.depthBiasConstantFactor = 0.0f;
-	Rasterizer.depthBiasClamp = 0.0f;
-	Rasterizer.depthBiasSlopeFactor = 0.0f;
-	Rasterizer.lineWidth = 1.0f;
+	free(Golden);
+	free(Image);
 
-	VkPipelineMultisampleStateCreateInfo Multisampling = {0};
-	Multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	Multisampling.pNext = NULL;
-	Multisampling.flags = 0;
-	Multisampling.rasterizationSamples = vkSamples;
-	Multisampling.sampleShadingEnable = VK_TRUE;
-	Multisampling.minSampleShading = 1.0f;
-	Multisampling.pSampleMask = NULL;
-	Multisampling.alphaToCoverageEnable = VK_TRUE;
-	Multisampling.alphaToOneEnable = VK_FALSE;
+	int Failed = Mismatched > Pixels * vkGoldenMismatch;
 
-	VkPipelineDepthStencilStateCreateInfo DepthStencil = {0};
-	DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	DepthStencil.pNext = NULL;
-	DepthStencil.flags = 0;
-	DepthStencil.depthTestEnable = VK_TRUE;
-	DepthStencil.depthWriteEnable = VK_TRUE;
-	DepthStencil.depthCompareOp = VK_COMPARE_OP_GREATER;
-	DepthStencil.depthBoundsTestEnable = VK_FALSE;
-	DepthStencil.stencilTestEnable = VK_FALSE;
-	DepthStencil.front = (VkStencilOpState){0};
-	DepthStencil.back = (VkStencilOpState){0};
-	DepthStencil.minDepthBounds = 0.0f;
-	DepthStencil.maxDepthBounds = 0.0f;
+	printf("golden %s %s, %u of %u pixels differ\n", Path, Failed ? "FAILED" : "ok", Mismatched, Pixels);
 
-	VkPipelineColorBlendAttachmentState BlendingAttachment = {0};
-	BlendingAttachment.blendEnable = VK_TRUE;
-	BlendingAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	BlendingAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-	BlendingAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	BlendingAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	BlendingAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	BlendingAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-	BlendingAttachment.colorWriteMask =
-		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	return Failed ? -1 : 0;
+}
 
-	VkPipelineColorBlendStateCreateInfo Blending = {0};
-	Blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	Blending.pNext = NULL;
-	Blending.flags = 0;
-	Blending.logicOpEnable = VK_FALSE;
-	Blending.logicOp = VK_LOGIC_OP_COPY;
-	Blending.attachmentCount = 1;
-	Blending.pAttachments = &BlendingAttachment;
-	Blending.blendConstants[0] = 0.0f;
-	Blending.blendConstants[1] = 0.0f;
-	Blending.blendConstants[2] = 0.0f;
-	Blending.blendConstants[3] = 0.0f;
 
-	VkDescriptorSetLayoutBinding Bindings[1] = {0};
+/*
+ * Checks the frame times of every scene against the baseline at Path, one
+ * line of name, frame time and GPU time in milliseconds per scene. A scene
+ * regresses when either time grows by more than vkBaselineSlack. Returns the
+ * number of regressions, or whether writing it failed with VULKAN_CHECK_UPDATE.
+ */
+static int
+VulkanCheckBaseline(
+	const char* Path,
+	const double* Times,
+	const double* GpuTimes
+	)
+{
+	if(vkCheckUpdate)
+	{
+		char Text[ARRAYLEN(vkCheckScenes) * 96];
+		int Used = 0;
 
-	Bindings[0].binding = 0;
-	Bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	Bindings[0].descriptorCount = 1;
-	Bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	Bindings[0].pImmutableSamplers = NULL;
+		for(uint32_t i = 0; i < ARRAYLEN(vkCheckScenes); ++i)
+		{
+			if(Times[i] > 0.0)
+			{
+				Used += snprintf(Text + Used, sizeof(Text) - Used, "%s %.4f %.4f\n",
+					vkCheckScenes[i].Name, Times[i] * 1000.0, GpuTimes[i] * 1000.0);
+			}
+		}
 
-	VkDescriptorSetLayoutCreateInfo Descriptors = {0};
-	Descriptors.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	Descriptors.pNext = NULL;
-	Descriptors.flags = 0;
-	Descriptors.bindingCount = ARRAYLEN(Bindings);
-	Descriptors.pBindings = Bindings;
+		int Status = WriteFile(Path, Used, (uint8_t*) Text);
 
-	Result = vkCreateDescriptorSetLayout(vkDevice, &Descriptors, NULL, &vkDescriptors);
-	AssertEQ(Result, VK_SUCCESS);
+		printf("baseline %s %s\n", Path, Status == 0 ? "written" : "could not be written");
 
-	VkPushConstantRange PushConstants[1] = {0};
+		return Status == 0 ? 0 : 1;
+	}
 
-	PushConstants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	PushConstants[0].offset = 0;
-	PushConstants[0].size = sizeof(VkVertexConstantInput);
+	uint64_t Length;
+	uint8_t* Baseline;
 
-	VkPipelineLayoutCreateInfo CreateInfo = {0};
-	CreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	CreateInfo.pNext = NULL;
-	CreateInfo.flags = 0;
-	CreateInfo.setLayoutCount = 1;
-	CreateInfo.pSetLayouts = &vkDescriptors;
-	CreateInfo.pushConstantRangeCount = ARRAYLEN(PushConstants);
-	CreateInfo.pPushConstantRanges = PushConstants;
+	if(ReadFile(Path, &Length, &Baseline) == -1)
+	{
+		printf("baseline %s MISSING, write it with VULKAN_CHECK_UPDATE\n", Path);
 
-	Result = vkCreatePipelineLayout(vkDevice, &CreateInfo, NULL, &vkPipelineLayout);
-	AssertEQ(Result, VK_SUCCESS);
+		return 1;
+	}
 
+	Baseline = realloc(Baseline, Length + 1);
+	AssertNEQ(Baseline, NULL);
+	Baseline[Length] = 0;
 
-	VkGraphicsPipelineCreateInfo PipelineInfo = {0};
-	PipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	PipelineInfo.pNext = NULL;
-	PipelineInfo.flags = 0;
-	PipelineInfo.stageCount = 2;
-	PipelineInfo.pStages = Stages;
-	PipelineInfo.pVertexInputState = &VertexInput;
-	PipelineInfo.pInputAssemblyState = &InputAssembly;
-	PipelineInfo.pTessellationState = NULL;
-	PipelineInfo.pViewportState = &ViewportState;
-	PipelineInfo.pRasterizationState = &Rasterizer;
-	PipelineInfo.pMultisampleState = &Multisampling;
-	PipelineInfo.pDepthStencilState = &DepthStencil;
-	PipelineInfo.pColorBlendState = &Blending;
-	PipelineInfo.pDynamicState = NULL;
-	PipelineInfo.layout = vkPipelineLayout;
-	PipelineInfo.renderPass = vkRenderPass;
-	PipelineInfo.subpass = 0;
-	PipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	PipelineInfo.basePipelineIndex = -1;
+	int Regressions = 0;
 
-	Result = vkCreateGraphicsPipelines(vkDevice, VK_NULL_HANDLE, 1, &PipelineInfo, NULL, &vkPipeline);
-	AssertEQ(Result, VK_SUCCESS);
+	const char* Line = (const char*) Baseline;
 
-	VulkanDestroyShader(VertexModule);
-	VulkanDestroyShader(FragmentModule);
+	while(*Line)
+	{
+		char Name[64];
+		double Time;
+		double GpuTime;
 
+		if(sscanf(Line, "%63s %lf %lf", Name, &Time, &GpuTime) == 3)
+		{
+			for(uint32_t i = 0; i < ARRAYLEN(vkCheckScenes); ++i)
+			{
+				if(strcmp(Name, vkCheckScenes[i].Name) != 0 || Times[i] <= 0.0)
+				{
+					continue;
+				}
 
-	VulkanInitFramebuffers();
+				int Regressed =
+					Times[i] * 1000.0 > Time * (1.0 + vkBaselineSlack) ||
+					(GpuTime > 0.0 && GpuTimes[i] * 1000.0 > GpuTime * (1.0 + vkBaselineSlack));
 
+				printf("baseline %s %s, frame %.3f ms (%.3f), GPU %.3f ms (%.3f)\n", Name,
+					Regressed ? "REGRESSED" : "ok", Times[i] * 1000.0, Time, GpuTimes[i] * 1000.0, GpuTime);
 
-	VkDescriptorPoolSize PoolSizes[2] = {0};
+				Regressions += Regressed;
+			}
+		}
 
-	PoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	PoolSizes[0].descriptorCount = vkImageCount;
+		const char* Next = strchr(Line, '\n');
 
-	PoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	PoolSizes[1].descriptorCount = vkImageCount;
+		if(Next == NULL)
+		{
+			break;
+		}
 
-	VkDescriptorPoolCreateInfo DescriptorInfo = {0};
-	DescriptorInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	DescriptorInfo.pNext = NULL;
-	DescriptorInfo.flags = 0;
-	DescriptorInfo.maxSets = vkImageCount;
-	DescriptorInfo.poolSizeCount = ARRAYLEN(PoolSizes);
-	DescriptorInfo.pPoolSizes = PoolSizes;
+		Line = Next + 1;
+	}
 
-	Result = vkCreateDescriptorPool(vkDevice, &DescriptorInfo, NULL, &vkDescriptorPool);
-	AssertEQ(Result, VK_SUCCESS);
+	free(Baseline);
+
+	return Regressions;
 }
 
 
-static void
-VulkanDestroyPipeline(
+/*
+ * Renders every scene that the device supports, captures its last frame for
+ * the golden image and times a fixed burst of frames for the baseline. The
+ * scenes run back to back in a fixed order, so the animation state each one
+ * starts from is the same on every run. Returns the number of failures.
+ */
+static int
+VulkanCheck(
 	void
 	)
 {
-	vkDestroyDescriptorPool(vkDevice, vkDescriptorPool, NULL);
-
-	VulkanDestroyFramebuffers();
+	const char* GoldenPath = getenv("VULKAN_GOLDEN");
+	const char* BaselinePath = getenv("VULKAN_BASELINE");
 
-	vkDestroyPipeline(vkDevice, vkPipeline, NULL);
-	vkDestroyPipelineLayout(vkDevice, vkPipelineLayout, NULL);
-	vkDestroyDescriptorSetLayout(vkDevice, vkDescriptors, NULL);
-	vkDestroyRenderPass(vkDevice, vkRenderPass, NULL);
-
-	VulkanDestroyTexture(&vkTexture);
-}
+	if(GoldenPath != NULL)
+	{
+		VulkanGetPreferredBuffer((VkDeviceSize) vkExtent.width * vkExtent.height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &vkCaptureBuffer, &vkCaptureMemory);
 
+		VkResult Result = vkMapMemory(vkDevice, vkCaptureMemory, 0, VK_WHOLE_SIZE, 0, (void**) &vkCaptureData);
+		AssertEQ(Result, VK_SUCCESS);
+	}
 
-static void
-VulkanInitObjects(
-	void
-	)
-{
-	VkFrame* Frame = vkFrames;
+	double Times[ARRAYLEN(vkCheckScenes)] = {0};
+	double GpuTimes[ARRAYLEN(vkCheckScenes)] = {0};
+	int Failures = 0;
 
-	do
+	for(uint32_t i = 0; i < ARRAYLEN(vkCheckScenes); ++i)
 	{
-		VkSemaphoreCreateInfo SemaphoreInfo = {0};
-		SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-		SemaphoreInfo.pNext = NULL;
-		SemaphoreInfo.flags = 0;
+		const CheckScene* Scene = vkCheckScenes + i;
 
-		VkSemaphore* Semaphore = Frame->Semaphores;
-		VkSemaphore* SemaphoreEnd = Frame->Semaphores + ARRAYLEN(Frame->Semaphores);
+		if(
+			!VulkanQualitySupported(Scene->Quality) ||
+			(Scene->Scale != 0 && !vkScalingSupported) ||
+			(Scene->HeatMap && vkHeatRenderPass == VK_NULL_HANDLE)
+			)
+		{
+			printf("scene %s skipped\n", Scene->Name);
+			continue;
+		}
 
-		do
+		VulkanSetQuality(Scene->Quality);
+		VulkanSetScaling(Scene->Scale != 0);
+
+		if(Scene->Scale != 0)
 		{
-			VkResult Result = vkCreateSemaphore(vkDevice, &SemaphoreInfo, NULL, Semaphore);
-			AssertEQ(Result, VK_SUCCESS);
+			VulkanSetScale(Scene->Scale);
 		}
-		while(++Semaphore != SemaphoreEnd);
 
+		vkHeatMap = Scene->HeatMap;
 
-		VkFenceCreateInfo FenceInfo = {0};
-		FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		FenceInfo.pNext = NULL;
-		FenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+		for(uint32_t j = 0; j < vkCheckWarmup; ++j)
+		{
+			VulkanDraw();
+		}
 
-		VkFence* Fence = Frame->Fences;
-		VkFence* FenceEnd = Frame->Fences + ARRAYLEN(Frame->Fences);
+		vkQueueWaitIdle(vkQueue);
+		double Start = VulkanTime();
 
-		do
+		for(uint32_t j = 0; j < vkCheckFrames; ++j)
 		{
-			VkResult Result = vkCreateFence(vkDevice, &FenceInfo, NULL, Fence);
-			AssertEQ(Result, VK_SUCCESS);
+			VulkanDraw();
 		}
-		while(++Fence != FenceEnd);
 
+		vkQueueWaitIdle(vkQueue);
+		Times[i] = (VulkanTime() - Start) / vkCheckFrames;
+		GpuTimes[i] = vkFrameTime;
 
-		VkDescriptorSetAllocateInfo AllocInfo = {0};
-		AllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		AllocInfo.pNext = NULL;
-		AllocInfo.descriptorPool = vkDescriptorPool;
-		AllocInfo.descriptorSetCount = 1;
-		AllocInfo.pSetLayouts = &vkDescriptors;
+		if(GoldenPath == NULL)
+		{
+			continue;
+		}
 
-		VkResult Result = vkAllocateDescriptorSets(vkDevice, &AllocInfo, &Frame->DescriptorSet);
-		AssertEQ(Result, VK_SUCCESS);
+		/* A frame dropped for an out of date swapchain leaves the flag set */
+		for(vkCapturing = 1; vkCapturing;)
+		{
+			VulkanDraw();
+		}
 
+		vkQueueWaitIdle(vkQueue);
 
-		VkDescriptorImageInfo ImageInfo = {0};
-		ImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		ImageInfo.imageView = vkTexture.View;
-		ImageInfo.sampler = vkSampler;
+		char Path[4096];
+		snprintf(Path, sizeof(Path), "%s/%s.ppm", GoldenPath, Scene->Name);
 
-		VkWriteDescriptorSet DescriptorWrites[1] = {0};
+		Failures += VulkanCheckGolden(Path) != 0;
+	}
 
-		DescriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		DescriptorWrites[0].pNext = NULL;
-		DescriptorWrites[0].dstSet = Frame->DescriptorSet;
-		DescriptorWrites[0].dstBinding = 0;
-		DescriptorWrites[0].dstArrayElement = 0;
-		DescriptorWrites[0].descriptorCount = 1;
-		DescriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		DescriptorWrites[0].pImageInfo = &ImageInfo;
-		DescriptorWrites[0].pBufferInfo = NULL;
-		DescriptorWrites[0].pTexelBufferView = NULL;
+	vkHeatMap = 0;
+	VulkanSetScaling(0);
+	VulkanSetQuality(0);
 
-		vkUpdateDescriptorSets(vkDevice, ARRAYLEN(DescriptorWrites), DescriptorWrites, 0, NULL);
+	if(BaselinePath != NULL)
+	{
+		Failures += VulkanCheckBaseline(BaselinePath, Times, GpuTimes);
 	}
-	while(++Frame != vkFrameEnd);
+
+	if(GoldenPath != NULL)
+	{
+		vkUnmapMemory(vkDevice, vkCaptureMemory);
+		vkDestroyBuffer(vkDevice, vkCaptureBuffer, NULL);
+		vkFreeMemory(vkDevice, vkCaptureMemory, NULL);
+	}
+
+	printf("check %s, %d failures\n", Failures ? "FAILED" : "passed", Failures);
+
+	return Failures;
 }
 
 
 static void
-VulkanDestroyObjects(
+VulkanInitReplay(
 	void
 	)
 {
-	VkFrame* Frame = vkFrames;
+	const char* Path = getenv("VULKAN_REPLAY");
 
-	do
+	if(Path == NULL || vkChecking)
 	{
-		VkFence* Fence = Frame->Fences;
-		VkFence* FenceEnd = Frame->Fences + ARRAYLEN(Frame->Fences);
-
-		do
-		{
-			vkDestroyFence(vkDevice, *Fence, NULL);
-		}
-		while(++Fence != FenceEnd);
+		return;
+	}
 
+	if(RecordOpen(&vkLog, Path) == -1)
+	{
+		printf("replay %s could not be opened\n", Path);
+		return;
+	}
 
-		VkSemaphore* Semaphore = Frame->Semaphores;
-		VkSemaphore* SemaphoreEnd = Frame->Semaphores + ARRAYLEN(Frame->Semaphores);
+	vkReplaying = 1;
 
-		do
-		{
-			vkDestroySemaphore(vkDevice, *Semaphore, NULL);
-		}
-		while(++Semaphore != SemaphoreEnd);
+	if(vkLog.Header.Quality < ARRAYLEN(vkQualities) && VulkanQualitySupported(vkLog.Header.Quality))
+	{
+		VulkanSetQuality(vkLog.Header.Quality);
 	}
-	while(++Frame != vkFrameEnd);
+	else
+	{
+		printf("replay quality not supported, using %s\n", vkQualities[vkQuality].Name);
+	}
+
+	VulkanSetScaling(vkLog.Header.Scaling != 0);
+	VulkanResetParticles();
 }
 
 
+/*
+ * Opened after the quality was picked, which the header keeps so a replay
+ * renders at the same tier.
+ */
 static void
-VulkanInitVertex(
+VulkanInitRecord(
 	void
 	)
 {
-	VulkanGetFinalBuffer(sizeof(vkVertexVertexInput), &vkVertexVertexInputBuffer, &vkVertexVertexInputMemory);
+	const char* Path = getenv("VULKAN_RECORD");
 
-	VulkanCopyToBuffer(vkVertexVertexInputBuffer, vkVertexVertexInput, sizeof(vkVertexVertexInput));
+	if(Path == NULL || vkChecking || vkReplaying)
+	{
+		return;
+	}
+
+	RecordHeader Header = {0};
+	Header.Quality = vkQuality;
+	Header.Scaling = vkScaling;
 
+	if(RecordCreate(&vkLog, Path, &Header) == -1)
+	{
+		printf("record %s could not be created\n", Path);
+		return;
+	}
 
-	VulkanGetFinalBuffer(sizeof(vkVertexInstanceInput), &vkVertexInstanceInputBuffer, &vkVertexInstanceInputMemory);
+	vkLogging = 1;
 
-	VulkanCopyToBuffer(vkVertexInstanceInputBuffer, vkVertexInstanceInput, sizeof(vkVertexInstanceInput));
+	VulkanResetParticles();
 }
 
 
 static void
-VulkanDestroyVertex(
+VulkanDestroyLog(
 	void
 	)
 {
-	vkFreeMemory(vkDevice, vkVertexInstanceInputMemory, NULL);
-	vkDestroyBuffer(vkDevice, vkVertexInstanceInputBuffer, NULL);
+	if(vkLogging)
+	{
+		printf("recorded %llu frames\n", (unsigned long long) vkLog.Frames);
+	}
 
-	vkFreeMemory(vkDevice, vkVertexVertexInputMemory, NULL);
-	vkDestroyBuffer(vkDevice, vkVertexVertexInputBuffer, NULL);
+	if(vkReplaying && vkLog.Frames != 0)
+	{
+		printf("replayed %llu frames, %.3f ms per frame, recorded at %.3f ms\n",
+			(unsigned long long) vkLog.Frames, vkReplayTime * 1000.0 / vkLog.Frames,
+			vkReplayRecordedTime * 1000.0 / vkLog.Frames);
+	}
+
+	if(vkLogging || vkReplaying)
+	{
+		RecordClose(&vkLog);
+	}
+
+	vkLogging = 0;
+	vkReplaying = 0;
 }
 
 
-static void
-VulkanUpdateConstants(
+/*
+ * Puts the next logged frame in place of the input VulkanDraw() reads.
+ * Returns 0 once the log has run out.
+ */
+static int
+VulkanReplayFrame(
 	void
 	)
 {
-	static float Rotation = 0;
-	Rotation += 0.0001;
-
-	float AspectRatio = (float) vkExtent.width / vkExtent.height;
-	vec3 RotationAxis = { 0.0f, 1.0f, 0.0f };
-	vec3 Eye = { 0.0f, 0.001f, 3.0f };
-	vec3 Center = { 0.0f, 0.0f, 0.0f };
-	vec3 Up = { 0.0f, 0.0f, 1.0f };
-
-	mat4 Model;
-	glm_mat4_identity(Model);
-	glm_rotate(Model, Rotation, RotationAxis);
+	if(!RecordRead(&vkLog))
+	{
+		return 0;
+	}
 
-	mat4 View;
-	glm_mat4_identity(View);
-	glm_lookat(Eye, Center, Up, View);
+	const RecordFrame* Frame = &vkLog.Frame;
 
-	mat4 Projection;
-	glm_mat4_identity(Projection);
-	glm_perspective(glm_rad(45), AspectRatio, 1000.0f, 0.01f, Projection);
-	//glm_ortho_default((float) vkExtent.width / vkExtent.height, Input.Projection);
+	vkQualityStep = Frame->QualitySteps;
+	vkScalingToggle = Frame->ScalingToggles;
+	vkHeatMapToggle = Frame->HeatMapToggles;
+	vkRotation = Frame->Rotation;
+	memcpy(vkView, Frame->View, sizeof(vkView));
 
-	mat4* Matrices[] =
+	if(vkScaling && Frame->Scale != vkScale)
 	{
-		&Projection,
-		&View,
-		&Model
-	};
+		VulkanSetScale(MIN(MAX(Frame->Scale, vkScaleMin), vkScaleSteps));
+	}
 
-	VkVertexConstantInput Constants = {0};
-	glm_mat4_mulN(Matrices, ARRAYLEN(Matrices), Constants.Transform);
+	vkReplayRecordedTime += Frame->FrameTime;
 
-	vkCmdPushConstants(vkFrame->CommandBuffer, vkPipelineLayout,
-		VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Constants), &Constants);
+	return 1;
 }
 
 
+/*
+ * Keeps the key presses before VulkanDraw() consumes them.
+ */
 static void
-VulkanRecordCommands(
-	uint32_t ImageIndex
+VulkanLogInput(
+	void
 	)
 {
-	VkCommandBufferBeginInfo BeginInfo = {0};
-	BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	BeginInfo.pNext = NULL;
-	BeginInfo.flags = 0;
-	BeginInfo.pInheritanceInfo = NULL;
-
-	VkResult Result = vkBeginCommandBuffer(vkFrame->CommandBuffer, &BeginInfo);
-	AssertEQ(Result, VK_SUCCESS);
-
-	VkDeviceSize Offset = 0;
-
-	VkClearValue ClearValues[2] = {0};
-
-	ClearValues[0].color = (VkClearColorValue){{ 0.0f, 0.0f, 0.0f, 0.0f }};
-	ClearValues[1].depthStencil = (VkClearDepthStencilValue){ 0.0f, 0 };
-
-
-	VkRenderPassBeginInfo RenderPassInfo = {0};
-	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	RenderPassInfo.pNext = NULL;
-	RenderPassInfo.renderPass = vkRenderPass;
-	RenderPassInfo.framebuffer = vkFramebuffers[ImageIndex];
-	RenderPassInfo.renderArea.offset.x = 0;
-	RenderPassInfo.renderArea.offset.y = 0;
-	RenderPassInfo.renderArea.extent = vkExtent;
-	RenderPassInfo.clearValueCount = ARRAYLEN(ClearValues);
-	RenderPassInfo.pClearValues = ClearValues;
-
-	vkCmdBeginRenderPass(vkFrame->CommandBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	vkCmdBindPipeline(vkFrame->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkPipeline);
-
-	vkCmdBindVertexBuffers(vkFrame->CommandBuffer, 0, 1, &vkVertexVertexInputBuffer, &Offset);
-	vkCmdBindVertexBuffers(vkFrame->CommandBuffer, 1, 1, &vkVertexInstanceInputBuffer, &Offset);
-
-	vkCmdBindDescriptorSets(vkFrame->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-		vkPipelineLayout, 0, 1, &vkFrame->DescriptorSet, 0, NULL);
-
-	VulkanUpdateConstants();
-
-	vkCmdDraw(vkFrame->CommandBuffer, ARRAYLEN(vkVertexVertexInput), ARRAYLEN(vkVertexInstanceInput), 0, 0);
-
-	vkCmdEndRenderPass(vkFrame->CommandBuffer);
-
-	Result = vkEndCommandBuffer(vkFrame->CommandBuffer);
-	AssertEQ(Result, VK_SUCCESS);
+	vkLog.Frame.QualitySteps = MIN(vkQualityStep, UINT8_MAX);
+	vkLog.Frame.ScalingToggles = MIN(vkScalingToggle, UINT8_MAX);
+	vkLog.Frame.HeatMapToggles = MIN(vkHeatMapToggle, UINT8_MAX);
 }
 
 
+/*
+ * Writes the frame with the state it was rendered with, the scale may have
+ * changed inside VulkanDraw().
+ */
 static void
-VulkanDraw(
-	void
+VulkanLogFrame(
+	double Time
 	)
 {
-	VkResult Result = vkWaitForFences(vkDevice, 1, vkFrame->Fences + FENCE_IN_FLIGHT, VK_TRUE, UINT64_MAX);
-	AssertEQ(Result, VK_SUCCESS);
-
-	uint32_t ImageIndex;
-	Result = vkAcquireNextImageKHR(vkDevice, vkSwapchain, UINT64_MAX,
-		vkFrame->Semaphores[SEMAPHORE_IMAGE_AVAILABLE], VK_NULL_HANDLE, &ImageIndex);
-
-	if(Result == VK_ERROR_OUT_OF_DATE_KHR)
+	if(vkReplaying)
 	{
-		vkExtent = VulkanGetExtent();
-
+		vkReplayTime += Time;
 		return;
 	}
 
-	Result = vkResetFences(vkDevice, 1, vkFrame->Fences + FENCE_IN_FLIGHT);
-	AssertEQ(Result, VK_SUCCESS);
-
-
-	Result = vkResetCommandBuffer(vkFrame->CommandBuffer, 0);
-	AssertEQ(Result, VK_SUCCESS);
-
-	VulkanRecordCommands(ImageIndex);
-
-	VkPipelineStageFlags WaitStages[] =
-	{
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-	};
-
-	VkSubmitInfo SubmitInfo = {0};
-	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	SubmitInfo.pNext = NULL;
-	SubmitInfo.waitSemaphoreCount = 1;
-	SubmitInfo.pWaitSemaphores = vkFrame->Semaphores + SEMAPHORE_IMAGE_AVAILABLE;
-	SubmitInfo.pWaitDstStageMask = WaitStages;
-	SubmitInfo.commandBufferCount = 1;
-	SubmitInfo.pCommandBuffers = &vkFrame->CommandBuffer;
-	SubmitInfo.signalSemaphoreCount = 1;
-	SubmitInfo.pSignalSemaphores = vkFrame->Semaphores + SEMAPHORE_RENDER_FINISHED;
-
-	Result = vkQueueSubmit(vkQueue, 1, &SubmitInfo, vkFrame->Fences[FENCE_IN_FLIGHT]);
-	AssertEQ(Result, VK_SUCCESS);
-
-	VkPresentInfoKHR PresentInfo = {0};
-	PresentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	PresentInfo.pNext = NULL;
-	PresentInfo.waitSemaphoreCount = 1;
-	PresentInfo.pWaitSemaphores = vkFrame->Semaphores + SEMAPHORE_RENDER_FINISHED;
-	PresentInfo.swapchainCount = 1;
-	PresentInfo.pSwapchains = &vkSwapchain;
-	PresentInfo.pImageIndices = &ImageIndex;
-	PresentInfo.pResults = NULL;
-
-	Result = vkQueuePresentKHR(vkQueue, &PresentInfo);
+	vkLog.Frame.FrameTime = Time;
+	vkLog.Frame.Rotation = vkRotation;
+	memcpy(vkLog.Frame.View, vkView, sizeof(vkView));
+	vkLog.Frame.Scale = vkScale;
 
-	if(Result == VK_ERROR_OUT_OF_DATE_KHR || Result == VK_SUBOPTIMAL_KHR)
+	if(RecordWrite(&vkLog) == -1)
 	{
-		vkExtent = VulkanGetExtent();
-	}
+		printf("record write failed, recording stopped\n");
 
-	if(++vkFrame == vkFrameEnd)
-	{
-		vkFrame = vkFrames;
+		VulkanDestroyLog();
 	}
 }
 
@@ -2280,33 +7560,77 @@ VulkanInit(
 	void
 	)
 {
+	vkChecking = getenv("VULKAN_GOLDEN") != NULL || getenv("VULKAN_BASELINE") != NULL;
+	vkCheckUpdate = getenv("VULKAN_CHECK_UPDATE") != NULL;
+
 	VulkanInitGLFW();
 	VulkanInitInstance();
 	VulkanInitSurface();
 	VulkanInitDevice();
 	VulkanInitSampler();
-	VulkanInitSwapchain();
-	VulkanInitDepthBuffer();
-	VulkanInitMultisampling();
+	if(vkChecking)
+	{
+		VulkanInitHeadless();
+	}
+	else
+	{
+		VulkanInitSwapchain();
+	}
+
+	VulkanInitAttachments();
+	VulkanInitOffscreen();
 	VulkanInitFrames();
+	VulkanInitQueries();
 	VulkanInitCommands();
+	VulkanInitHeatMap();
 	VulkanInitPipeline();
 	VulkanInitObjects();
 	VulkanInitVertex();
+	VulkanInitScene();
+	VulkanInitTilemap(256, 256);
+	VulkanInitParticles();
+	VulkanInitReplay();
+
+	if(!vkChecking && !vkReplaying)
+	{
+		VulkanInitQuality();
+		VulkanSetScaling(getenv("VULKAN_DYNAMIC_RESOLUTION") != NULL);
+	}
+
+	VulkanInitRecord();
+	VulkanInitReload();
 }
 
 static long double fps[10000];
 static uintptr_t fps_c = 0;
 
-void
+int
 VulkanRun(
 	void
 	)
 {
+	if(vkChecking)
+	{
+		int Failures = VulkanCheck();
+		vkDeviceWaitIdle(vkDevice);
+
+		return Failures != 0;
+	}
+
 	while(!glfwWindowShouldClose(Window))
 	{
 		glfwPollEvents();
 
+		if(vkReplaying && !VulkanReplayFrame())
+		{
+			break;
+		}
+
+		if(vkLogging)
+		{
+			VulkanLogInput();
+		}
+
 		struct timespec start = {0};
 		clock_gettime(CLOCK_REALTIME, &start);
 		uint64_t start_time = start.tv_nsec + start.tv_sec * 1000000000;
@@ -2317,6 +7641,11 @@ VulkanRun(
 		clock_gettime(CLOCK_REALTIME, &end);
 		uint64_t end_time = end.tv_nsec + end.tv_sec * 1000000000;
 
+		if(vkLogging || vkReplaying)
+		{
+			VulkanLogFrame((end_time - start_time) / 1000000000.0);
+		}
+
 		fps[fps_c] = (long double) 1000000000.0 / (end_time - start_time);
 		fps_c = (fps_c + 1) % ARRAYLEN(fps);
 
@@ -2336,6 +7665,8 @@ VulkanRun(
 	}
 
 	vkDeviceWaitIdle(vkDevice);
+
+	return 0;
 }
 
 
@@ -2344,16 +7675,35 @@ VulkanFree(
 	void
 	)
 {
+	VulkanDestroyReload();
+	VulkanDestroyLog();
+	VulkanCollectRetired(1);
+	VulkanFreeDrawList();
+	VulkanDestroyParticles();
+	VulkanDestroyTilemap();
+	VulkanDestroyScene();
+
 	VulkanDestroyCopyBuffer();
 
 	VulkanDestroyVertex();
 	VulkanDestroyObjects();
 	VulkanDestroyPipeline();
+	VulkanDestroyHeatMap();
+	VulkanDestroyAttachments();
 	VulkanDestroyCommands();
+	VulkanDestroyQueries();
 	VulkanDestroyFrames();
-	VulkanDestroyDepthBuffer();
-	VulkanDestroyMultisampling();
-	VulkanDestroySwapchain();
+	VulkanDestroyOffscreen();
+
+	if(vkChecking)
+	{
+		VulkanDestroyHeadless();
+	}
+	else
+	{
+		VulkanDestroySwapchain();
+	}
+
 	VulkanDestroySampler();
 	VulkanDestroyDevice();
 	VulkanDestroySurface();